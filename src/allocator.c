@@ -0,0 +1,25 @@
+#include <stdlib.h>
+
+#include "allocator.h"
+
+static void *default_alloc(__attribute__((unused)) void *context, size_t size)
+{
+    return malloc(size);
+}
+
+static void *default_realloc(__attribute__((unused)) void *context, void *ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void default_free(__attribute__((unused)) void *context, void *ptr)
+{
+    free(ptr);
+}
+
+const Allocator DEFAULT_ALLOCATOR = {
+    .alloc   = default_alloc,
+    .realloc = default_realloc,
+    .free    = default_free,
+    .context = NULL
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <stddef.h>
+
+/*
+ * Allocation functions with a user-defined context, e.g. to use pools or arenas or to account for memory.
+ * realloc and free are only called with pointers obtained from the same allocator.
+ */
+typedef struct
+{
+    void *(*alloc)(void *context, size_t size);
+    void *(*realloc)(void *context, void *ptr, size_t size);
+    void (*free)(void *context, void *ptr);
+    void *context;
+} Allocator;
+
+// Uses malloc, realloc and free
+extern const Allocator DEFAULT_ALLOCATOR;
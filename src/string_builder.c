@@ -5,12 +5,17 @@
 
 StringBuilder strb_create()
 {
-    StringBuilder builder = vec_create(sizeof(char), 2);
+    return strb_create_with_allocator(&DEFAULT_ALLOCATOR);
+}
+
+StringBuilder strb_create_with_allocator(const Allocator *allocator)
+{
+    StringBuilder builder = vec_create_with_allocator(sizeof(char), 2, allocator);
     *(char*)vec_push_empty(&builder) = '\0';
     return builder;
 }
 
-// It is very important that heap_string was dynamically allocated
+// It is very important that heap_string was allocated by malloc
 StringBuilder strb_from_heapstring(char *heap_string)
 {
     size_t len = strlen(heap_string) + 1;
@@ -18,7 +23,8 @@ StringBuilder strb_from_heapstring(char *heap_string)
         .elem_size   = sizeof(char),
         .elem_count  = len,
         .buffer_size = len,
-        .buffer      = heap_string
+        .buffer      = heap_string,
+        .allocator   = &DEFAULT_ALLOCATOR
     };
     return builder;
 }
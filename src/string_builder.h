@@ -7,6 +7,7 @@
 typedef Vector StringBuilder;
 
 StringBuilder strb_create();
+StringBuilder strb_create_with_allocator(const Allocator *allocator);
 StringBuilder strb_from_heapstring(char *heap_string);
 void strb_clear(StringBuilder *builder);
 void strb_append(StringBuilder *builder, const char *fmt, ...);
@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdarg.h>
@@ -7,6 +8,8 @@
 
 #define ESC_START  27
 #define ESC_END   109
+// Longer texts are never numbers
+#define MAX_NUMBER_LENGTH 64
 
 bool is_space(char c)
 {
@@ -128,6 +131,45 @@ size_t get_line_of_string(const char *string, size_t line_index, char **out_star
     return count;
 }
 
+/*
+Summary: Like get_line_of_string, but string is a slice of length bytes that does not need to be \0-terminated
+Returns: Length of line (excluding \n), *out_start is set to NULL when string does not have that many lines
+*/
+size_t get_line_of_slice(const char *string, size_t length, size_t line_index, const char **out_start)
+{
+    *out_start = NULL;
+    if (string == NULL) return 0;
+
+    const char *end = string + length;
+    while (line_index > 0)
+    {
+        const char *newline = memchr(string, '\n', end - string);
+        if (newline == NULL) return 0;
+        string = newline + 1;
+        line_index--;
+    }
+
+    *out_start = string;
+    const char *newline = memchr(string, '\n', end - string);
+    return (newline != NULL ? newline : end) - string;
+}
+
+/*
+Summary: Like skip_ansi, but does not read beyond end
+*/
+const char *skip_ansi_bounded(const char *str, const char *end)
+{
+    if (str < end && *str == ESC_START)
+    {
+        while (str < end && *str != ESC_END)
+        {
+            str++;
+        }
+        if (str < end) str++;
+    }
+    return str;
+}
+
 char *skip_ansi(const char *str)
 {
     if (*str == ESC_START)
@@ -157,6 +199,34 @@ char *strip(char *str)
     return res;
 }
 
+/*
+Summary: Parses a decimal number surrounded by spaces, like "-1.5" or " 2e3 ". Texts of nan, infinity
+    or hexadecimal numbers are no numbers, though strtod accepts them.
+Returns: True iff the text is a number, it is in out_number then
+*/
+bool parse_number(const char *text, size_t length, double *out_number)
+{
+    while (length > 0 && is_space(*text))
+    {
+        text++;
+        length--;
+    }
+    while (length > 0 && is_space(text[length - 1])) length--;
+    if (length == 0 || length >= MAX_NUMBER_LENGTH) return false;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (strchr("0123456789.+-eE", text[i]) == NULL) return false;
+    }
+
+    // Texts are not \0-terminated
+    char number[MAX_NUMBER_LENGTH];
+    memcpy(number, text, length);
+    number[length] = '\0';
+    char *number_end;
+    *out_number = strtod(number, &number_end);
+    return number_end == number + length;
+}
+
 const char *first_char(const char* string)
 {
     const char *curr = string;
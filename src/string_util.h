@@ -1,6 +1,7 @@
 #pragma once
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 bool is_space(char c);
 bool is_digit(char c);
@@ -11,8 +12,11 @@ bool is_delimiter(const char *c);
 bool begins_with(const char *prefix, const char *str);
 size_t str_split(char *str, char **out_strs, size_t num_delimiters, ...);
 size_t get_line_of_string(const char *string, size_t line_index, char **out_start);
+size_t get_line_of_slice(const char *string, size_t length, size_t line_index, const char **out_start);
 char *skip_ansi(const char *str);
+const char *skip_ansi_bounded(const char *str, const char *end);
 char *strip(char *str);
+bool parse_number(const char *text, size_t length, double *out_number);
 const char *first_char(const char* string);
 char to_lower(char c);
 char to_upper(char c);
@@ -1,93 +1,64 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/mman.h>
 
-#include "string_builder.h"
 #include "string_util.h"
-#include "table.h"
+#include "table_internal.h"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-struct Cell
-{
-    char *text;         // Actual content to be displayed
-    size_t text_height; // Number of lines
-    size_t text_width;  // Maximum width of lines
-
-    // Settings
-    TableHAlign h_align;           // Non default, how to place text in col width
-    TableVAlign v_align;           // Non default, how to place text in col width
-    TableBorderStyle border_left;  // Non-default border left
-    TableBorderStyle border_above; // Non-default border above
-    size_t span_x;                 // How many cols to span over
-    size_t span_y;                 // How many rows to span over
-
-    // Generated
-    bool override_v_align;      // Default set for each col in table
-    bool override_h_align;      // Default set for each col in table
-    bool override_border_left;  // Default set for each col in table
-    bool override_border_above; // Default set in row
-
-    bool is_set;          // Indicates whether data is valid
-    bool text_needs_free; // When set to true, text will be freed on free_table
-    size_t x;             // Column position
-    size_t y;             // Row position
-    struct Cell *parent;  // Cell that spans into this cell
-};
-
-struct Row
-{
-    struct Cell cells[TABLE_MAX_COLS]; // All cells of this row from left to right
-    struct Row *next_row;              // Pointer to next row or NULL if last row
-    TableBorderStyle border_above;     // Default border above (can be overwritten in cell)
-    int border_above_counter;       // Counts cells that override their border_above
-};
-
-struct Table
-{
-    size_t num_cols;                         // Number of columns (max. of num_cells over all rows)
-    size_t num_rows;                         // Number of rows (length of linked list)
-    struct Row *first_row;                   // Start of linked list to rows
-    struct Row *curr_row;                    // Marker of row of next inserted cell
-    size_t curr_col;                         // Marker of col of next inserted cell
-    TableBorderStyle borders_left[TABLE_MAX_COLS]; // Default left border of cols
-    TableHAlign h_aligns[TABLE_MAX_COLS];          // Default horizontal alignment of cols
-    TableVAlign v_aligns[TABLE_MAX_COLS];          // Default vertical alignment of cols
-    int border_left_counters[TABLE_MAX_COLS];   // Counts cells that override their border_left
-};
-
-// Represents a size contraint in one dimension imposed by a single cell
-struct Constraint
+// State of a single pass of printing
+struct Render
 {
-    size_t from_index; // Inclusive
-    size_t to_index;   // Exclusive
-    size_t min;        // Needed size (i.e. minimum size needed)
-};
-
-static char *BORDER_MATRIX_SINGLE[] = {
-    "┌", "┬", "┐",
-    "├", "┼", "┤",
-    "└", "┴", "┘",
-    "─", "│", " ",
-};
-
-static char *BORDER_MATRIX_DOUBLE[] = {
-    "╔", "╦", "╗",
-    "╠", "╬", "╣",
-    "╚", "╩", "╝",
-    "═", "║", " ",
+    Table *table;
+    struct Output *out;
+    struct Row **rows;                    // Snapshot of rows in memory that are printed
+    size_t num_rows;                      // Number of rows in snapshot, including spilled ones
+    struct SpillReader *spilled;          // Reads rows of spill file, they follow rows[0]
+    size_t num_spilled;                   // Number of rows read from spill file
+    size_t num_cols;                      // Number of printed columns
+    size_t cols[TABLE_MAX_COLS];          // Column of table that is printed as col
+    bool ignore_spans;                    // Views print every cell on its own, spanned cells stay empty
+    size_t row_index;                     // Row that is printed currently
+    struct SpanSweep spans;               // Spans over current row
+    struct SpanSweep prev_spans;          // Spans over previous row
+    size_t col_widths[TABLE_MAX_COLS];
+    size_t *row_heights;
+    size_t line_indices[TABLE_MAX_COLS];  // Next line of cell that occupies col
+    size_t total_heights[TABLE_MAX_COLS]; // Height of cell that occupies col, including hlines it spans over
+    size_t cell_heights[TABLE_MAX_COLS];  // Shown lines of cell that occupies col, when its col has limits
+    const char *line_starts[TABLE_MAX_COLS]; // Next display line of cell that occupies col, when its col has limits
+    uint16_t attrs[TABLE_MAX_COLS];       // Default style of cell that occupies col, style rules applied
+    TableHAlign h_aligns[TABLE_MAX_COLS]; // Default alignment of cell that occupies col, style rules applied
+    bool has_vline[TABLE_MAX_COLS];       // Whether a vline is printed left of col
+    bool hide_last_col_hlines;            // Last col is empty, so hlines end at its left border
+    bool hide_last_row_vlines;            // Last row is empty, so vlines end at its top border
+    uint16_t active_attr;                 // Attribute the terminal is set to by previous output
+    struct Output *target;                // Output printing ends up in
+    struct Compactor compactor;           // State of compacting output
+    struct Output compacting;             // Forwards to target when table has a compact mode
+    bool has_entered_row;                 // Border above row_index was printed
+    size_t row_line;                      // Next line of content of row_index
+    bool is_nested;                       // Printed into cells of other tables, whitespace is not compacted
+    bool is_simple;                       // No spans, multi-line cells, border overrides or limits, see print_simple_line
+    const struct Glyph *vlines[TABLE_MAX_COLS]; // Vline left of col when table is simple, NULL for a space
 };
 
-static size_t HLINE_INDEX = 9;
-static size_t VLINE_INDEX = 10;
-
-// Index encodes whether a border intersects (0: no intersection, 1: intersection), clockwise
+// Index encodes whether a border intersects (0: no intersection, 1: intersection), clockwise. Values index struct Glyphs.
 static size_t BORDER_LOOKUP[16] = { 11, 11, 11, 6, 11, 10, 0, 3, 11, 8, 9, 7, 2, 5, 1, 4 };
 
+// Rows in spill file can not be reached, they are not linked
 static struct Row *get_row(const Table *table, size_t index)
 {
+    size_t num_spilled = get_num_spilled(table);
+    assert(index == 0 || index > num_spilled);
+    if (index > 0) index -= num_spilled;
     struct Row *row = table->first_row;
     while (index-- > 0 && row != NULL) row = row->next_row;
     return row;
@@ -95,16 +66,19 @@ static struct Row *get_row(const Table *table, size_t index)
 
 static TableHAlign get_h_align(TableHAlign default_h, const struct Cell *cell)
 {
-    if (cell->parent != NULL) return get_h_align(default_h, cell->parent);
     return (cell->override_h_align ? cell->h_align : default_h);
 }
 
 static TableVAlign get_v_align(TableVAlign default_v, const struct Cell *cell)
 {
-    if (cell->parent != NULL) return get_v_align(default_v, cell->parent);
     return (cell->override_v_align ? cell->v_align : default_v);
 }
 
+static uint16_t get_attr(uint16_t default_attr, const struct Cell *cell)
+{
+    return (cell->override_attr ? cell->attr : default_attr);
+}
+
 /*
 Summary: Calculates length of string displayed in console,
     i.e. reads until \0 or \n and omits ANSI-escaped color sequences
@@ -122,58 +96,87 @@ size_t console_strlen(const char *str)
     return res;
 }
 
-// Counts number of \n in string
-static size_t get_text_height(const char *str)
+/*
+Summary: Like console_strlen, but for a line that is a slice of length bytes
+*/
+static size_t console_strnlen(const char *str, size_t length)
 {
-    if (str == NULL) return 0;
-    size_t res = 1;
-    size_t pos = 0;
-    while (str[pos] != '\0')
+    const char *end = str + length;
+    size_t res = 0;
+    while (str < end)
     {
-        if (str[pos] == '\n')
+        // Count whole run of bytes until next escape sequence at once
+        const char *escape = memchr(str, '\033', end - str);
+        if (escape == NULL)
         {
-            res++;
+            res += end - str;
+            break;
         }
-        pos++;
+        res += escape - str;
+        str = skip_ansi_bounded(escape, end);
     }
     return res;
 }
 
-static size_t get_text_width(const char *str)
+// Determines number of lines and maximum width of lines in a single pass
+static void measure_text(const char *text, size_t length, size_t *out_height, size_t *out_width, bool *out_has_escapes)
 {
-    size_t res = 0;
-    size_t height = get_text_height(str);
-    for (size_t i = 0; i < height; i++)
-    {
-        char *line;
-        get_line_of_string(str, i, &line);
-        size_t line_width = console_strlen(line);
-        if (line_width > res) res = line_width;
+    *out_height = 0;
+    *out_width = 0;
+    *out_has_escapes = false;
+    if (text == NULL) return;
+
+    // Width of lines without color codes is their number of bytes
+    *out_has_escapes = memchr(text, '\033', length) != NULL;
+    const char *end = text + length;
+    while (true)
+    {
+        const char *newline = memchr(text, '\n', end - text);
+        const char *line_end = newline != NULL ? newline : end;
+        size_t line_width = *out_has_escapes ? console_strnlen(text, line_end - text) : (size_t)(line_end - text);
+        if (line_width > *out_width) *out_width = line_width;
+        (*out_height)++;
+        if (newline == NULL) break;
+        text = newline + 1;
     }
-    return res;
 }
 
-static void print_repeated(const char *string, size_t times, FILE *stream)
+// Glyph is repeated into a chunk that is written at once, single-byte glyphs are just set
+static void print_repeated(const struct Glyph *glyph, size_t times, struct Output *out)
 {
-    for (size_t i = 0; i < times; i++)
+    char chunk[256];
+    size_t per_chunk = sizeof(chunk) / glyph->length;
+    size_t filled = MIN(times, per_chunk);
+    if (glyph->length == 1)
     {
-        fprintf(stream, "%s", string);
+        memset(chunk, glyph->bytes[0], filled);
+    }
+    else
+    {
+        for (size_t i = 0; i < filled; i++) memcpy(chunk + i * glyph->length, glyph->bytes, glyph->length);
+    }
+
+    while (times > 0)
+    {
+        size_t count = MIN(times, per_chunk);
+        out_write(out, chunk, count * glyph->length);
+        times -= count;
     }
 }
 
+static void print_glyph(const struct Glyph *glyph, struct Output *out)
+{
+    out_write(out, glyph->bytes, glyph->length);
+}
+
 static void print_text(const struct Cell *cell,
     TableHAlign default_h,
     TableVAlign default_v,
     size_t line_index,
     int total_width,
     size_t total_height,
-    FILE *stream)
+    struct Output *out)
 {
-    if (cell->parent != NULL)
-    {
-        cell = cell->parent;
-    }
-
     // First, select actual line that needs to be printed based on vertical alignment
     int actual_line = 0;
     switch (get_v_align(default_v, cell))
@@ -188,88 +191,264 @@ static void print_text(const struct Cell *cell,
             actual_line = line_index - (total_height - cell->text_height);
     }
 
-    char *string = NULL;
+    const char *string = NULL;
     int bytes = 0;
     
-    if (actual_line >= 0)
+    if (actual_line >= 0 && cell->nested != NULL)
+    {
+        bytes = get_nested_line(cell->nested, actual_line, &string);
+    }
+    else if (actual_line >= 0)
     {
-        bytes = get_line_of_string(cell->text, actual_line, &string);
+        bytes = get_line_of_slice(cell->text, cell->text_length, actual_line, &string);
     }
 
     if (string == NULL)
     {
-        fprintf(stream, "%*s", total_width, "");
+        out_spaces(out, total_width);
         return;
     }
 
-    // Lengths passed to printf are including color codes
-    // We need to adjust the total length to include them
-    int string_length = console_strlen(string);
-    int adjusted_total_len = total_width + bytes - string_length;
+    // Padding only depends on displayed length, color codes are written as they are.
+    // Lines of nested tables are as wide as their layout, glyphs of their borders take several bytes.
+    int string_length;
+    if (cell->nested != NULL)
+    {
+        string_length = cell->text_width;
+    }
+    else
+    {
+        string_length = cell->has_escapes ? (int)console_strnlen(string, bytes) : bytes;
+    }
+    int padding = total_width > string_length ? total_width - string_length : 0;
+    // Renderings of nested tables are overwritten when they change, so plans must copy their lines
+    void (*emit)(struct Output*, const char*, size_t) = cell->nested != NULL ? out_write : out_text;
 
     switch (get_h_align(default_h, cell))
     {
         case H_ALIGN_LEFT:
         {
-            fprintf(stream, "%-*.*s", adjusted_total_len, bytes, string);
+            emit(out, string, bytes);
+            out_spaces(out, padding);
             break;
         }
         case H_ALIGN_RIGHT:
         {
-            fprintf(stream, "%*.*s", adjusted_total_len, bytes, string);
+            out_spaces(out, padding);
+            emit(out, string, bytes);
             break;
         }
         case H_ALIGN_CENTER:
         {
-            int padding = (total_width - string_length) / 2;
-            fprintf(stream, "%*s%.*s%*s", padding, "", bytes, string,
-                (total_width - string_length) % 2 == 0 ? padding : padding + 1, "");
+            out_spaces(out, padding / 2);
+            emit(out, string, bytes);
+            out_spaces(out, padding - padding / 2);
             break;
         }
     }
 }
 
-static size_t get_total_width(const Table *table, const size_t *col_widths, struct Cell *cell)
+// Writes color codes of text that is not shown, so the terminal ends up in the style the text leaves it in
+static void print_hidden_escapes(const char *text, const char *end, struct Output *out)
+{
+    while ((text = memchr(text, '\033', end - text)) != NULL)
+    {
+        const char *escape_end = skip_ansi_bounded(text, end);
+        out_text(out, text, escape_end - text);
+        text = escape_end;
+    }
+}
+
+/*
+Summary: Like print_text for cells in cols with limits. Lines of a cell have to be printed in order,
+    each continues at the display line the previous one ended at.
+*/
+static void print_limited_text(struct Render *render, const struct Cell *cell, size_t col,
+    TableHAlign default_h, TableVAlign default_v, size_t line_index, size_t total_width)
+{
+    struct Output *out = render->out;
+    size_t height = render->cell_heights[col];
+    size_t total_height = render->total_heights[col];
+    size_t offset = 0;
+    switch (get_v_align(default_v, cell))
+    {
+        case V_ALIGN_TOP:
+            break;
+        case V_ALIGN_CENTER:
+            offset = (total_height - height) / 2;
+            break;
+        case V_ALIGN_BOTTOM:
+            offset = total_height - height;
+    }
+    if (line_index < offset || line_index - offset >= height)
+    {
+        out_spaces(out, total_width);
+        return;
+    }
+
+    size_t actual_line = line_index - offset;
+    if (actual_line == 0) render->line_starts[col] = cell->text;
+    struct DisplayLine line;
+    get_display_line(render->table, cell, render->line_starts[col], &line);
+    render->line_starts[col] = line.next;
+
+    // Last shown line ends with an ellipsis when lines are hidden below it
+    const char *end = cell->text + cell->text_length;
+    const char *hidden_end = line.next != NULL ? line.next : end;
+    bool hides_lines = actual_line + 1 == height && line.next != NULL;
+    size_t ellipsis_width = get_ellipsis_width(render->table, total_width);
+    if (hides_lines)
+    {
+        hidden_end = end;
+        if (!line.is_cut && line.width + ellipsis_width > total_width)
+        {
+            line.length = take_columns(line.start, line.start + line.length, total_width - ellipsis_width);
+            line.width = total_width - ellipsis_width;
+        }
+        line.is_cut = true;
+    }
+
+    size_t width = line.width + (line.is_cut ? ellipsis_width : 0);
+    size_t padding = total_width > width ? total_width - width : 0;
+    size_t padding_left = 0;
+    switch (get_h_align(default_h, cell))
+    {
+        case H_ALIGN_LEFT:
+            break;
+        case H_ALIGN_RIGHT:
+            padding_left = padding;
+            break;
+        case H_ALIGN_CENTER:
+            padding_left = padding / 2;
+    }
+
+    out_spaces(out, padding_left);
+    out_text(out, line.start, line.length);
+    if (line.is_cut)
+    {
+        // Only an ellipsis of single-byte columns is cut
+        const struct Glyphs *glyphs = &render->table->glyphs;
+        out_write(out, glyphs->ellipsis.bytes, glyphs->ellipsis.length - (glyphs->ellipsis_width - ellipsis_width));
+        if (cell->has_escapes) print_hidden_escapes(line.start + line.length, hidden_end, out);
+    }
+    out_spaces(out, padding - padding_left);
+}
+
+// Rows of spill file are printed after the first row, they have to be visited in order
+static struct Row *get_render_row(const struct Render *render, size_t row_index)
+{
+    if (row_index > 0 && row_index <= render->num_spilled) return read_spilled_row(render->spilled, row_index - 1);
+    return render->rows[row_index > render->num_spilled ? row_index - render->num_spilled : 0];
+}
+
+static struct Cell *get_cell(const struct Render *render, size_t row_index, size_t col)
+{
+    return &get_render_row(render, row_index)->cells[render->cols[col]];
+}
+
+/*
+Summary: Finds cell that spans over cell in col of row with index row_index.
+    Only the current and the previous row are known while printing.
+Returns: NULL when cell is not spanned over
+*/
+static const struct Cell *get_parent(const struct Render *render, size_t row_index, size_t col)
+{
+    if (render->ignore_spans) return NULL;
+    assert(row_index == render->row_index || row_index + 1 == render->row_index);
+    const struct SpanSweep *spans = row_index == render->row_index ? &render->spans : &render->prev_spans;
+    return get_spanning_cell(spans, get_render_row(render, row_index), render->cols[col]);
+}
+
+// Cell whose text is printed in col, i.e. the cell spanning over it or the cell itself
+static const struct Cell *get_printed_cell(const struct Render *render, size_t row_index, size_t col)
+{
+    const struct Cell *parent = get_parent(render, row_index, col);
+    return parent != NULL ? parent : get_cell(render, row_index, col);
+}
+
+// Width of cell that is printed in col, including vlines it spans over
+static size_t get_total_width(const struct Render *render, size_t col, const struct Cell *cell)
 {
-    if (cell->parent != NULL) cell = cell->parent;
+    if (render->ignore_spans) return render->col_widths[col];
 
     size_t sum = 0;
     for (size_t i = 0; i < cell->span_x; i++)
     {
-        if (i != 0
-            && table->border_left_counters[cell->x + i] > 0)
+        if (i != 0 && render->has_vline[cell->x + i])
         {
             sum++;
         }
-        sum += col_widths[cell->x + i];
+        sum += render->col_widths[cell->x + i];
     }
     return sum;
 }
 
-static size_t get_total_height(const Table *table, const size_t *row_heights, struct Cell *cell)
+// Height of cell that begins in row with index row_index, including hlines it spans over
+static size_t get_total_height(const struct Render *render, size_t row_index, const struct Cell *cell)
 {
-    if (cell->parent != NULL) cell = cell->parent;
-
+    size_t span_y = render->ignore_spans ? 1 : cell->span_y;
     size_t sum = 0;
-    struct Row *curr_row = get_row(table, cell->y);
-    for (size_t i = 0; i < cell->span_y; i++)
+    for (size_t i = 0; i < span_y && row_index + i < render->num_rows; i++)
     {
-        if (i != 0 && curr_row->border_above_counter > 0) sum++;
-        sum += row_heights[cell->y + i];
-        curr_row = curr_row->next_row;
+        if (i != 0 && get_render_row(render, row_index + i)->border_above_counter > 0) sum++;
+        sum += render->row_heights[row_index + i];
     }
     return sum;
 }
 
-static size_t get_span_x(struct Cell *cell)
+static void switch_attr(struct Render *render, uint16_t attr)
+{
+    if (render->active_attr == attr) return;
+    out_attr_change(render->out, render->active_attr, attr);
+    render->active_attr = attr;
+}
+
+// Prints a line of cell that is printed in col in its style, padding included
+static void print_cell_line(struct Render *render, const struct Cell *cell, size_t col, size_t line_index)
 {
-    if (cell->parent != NULL)
+    const Table *table = render->table;
+    size_t table_col = render->cols[col];
+    uint16_t attr = get_attr(render->attrs[col], cell);
+    switch_attr(render, attr);
+    if (has_limits(table, cell))
+    {
+        print_limited_text(render, cell, col,
+            render->h_aligns[col],
+            table->v_aligns[table_col],
+            line_index,
+            get_total_width(render, col, cell));
+    }
+    else
     {
-        return cell->parent->span_x;
+        print_text(cell,
+            render->h_aligns[col],
+            table->v_aligns[table_col],
+            line_index,
+            get_total_width(render, col, cell),
+            render->total_heights[col],
+            render->out);
+    }
+
+    // Color codes in text may have changed the style of the terminal
+    if (cell->has_escapes && attr != ATTR_DEFAULT) render->active_attr = ATTR_UNKNOWN;
+}
+
+// False iff cell in col is spanned over by a cell of a row above
+static bool begins_in_row(const struct Render *render, size_t row_index, size_t col)
+{
+    const struct Cell *parent = get_parent(render, row_index, col);
+    return parent == NULL || parent == &get_render_row(render, row_index)->cells[parent->x];
+}
+
+static size_t get_span_x(const struct Render *render, size_t row_index, size_t col)
+{
+    if (render->ignore_spans)
+    {
+        return 1;
     }
     else
     {
-        return cell->span_x;
+        return get_printed_cell(render, row_index, col)->span_x;
     }
 }
 
@@ -297,51 +476,95 @@ static TableBorderStyle get_border_left(TableBorderStyle default_style, const st
     }
 }
 
-static void count_styles(TableBorderStyle style, size_t *out_num_single, size_t *out_num_double)
+// Borders of the last row and col are hidden while printing when they are empty, the table itself is not changed
+static TableBorderStyle get_border_left_at(const struct Render *render, size_t row_index, size_t col)
 {
-    if (style == BORDER_SINGLE) (*out_num_single)++;
-    if (style == BORDER_DOUBLE) (*out_num_double)++;
+    if (render->hide_last_row_vlines && row_index == render->num_rows - 1) return BORDER_NONE;
+    const struct Cell *parent = get_parent(render, row_index, col);
+    if (parent != NULL && parent->x != render->cols[col]) return BORDER_NONE;
+    return get_border_left(render->table->borders_left[render->cols[col]], get_cell(render, row_index, col));
 }
 
-static void print_intersection_char(
-    TableBorderStyle default_right_border_left,
-    TableBorderStyle default_below_border_above,
-    struct Cell *right_above,
-    struct Cell *left_below,
-    struct Cell *right_below,
-    FILE *stream)
+static TableBorderStyle get_border_above_at(const struct Render *render, size_t row_index, size_t col)
 {
-    size_t num_single = 0;
-    size_t num_double = 0;
+    if (render->hide_last_col_hlines && col == render->num_cols - 1) return BORDER_NONE;
+    if (!begins_in_row(render, row_index, col)) return BORDER_NONE;
+    return get_border_above(get_render_row(render, row_index)->border_above, get_cell(render, row_index, col));
+}
 
-    TableBorderStyle above = BORDER_NONE;
-    if (right_above != NULL)
-    {
-        above = get_border_left(default_right_border_left, right_above);
-        count_styles(above, &num_single, &num_double);
-    }
+static bool overrides_border_left(const struct Cell *cell)
+{
+    return cell->override_border_left && cell->border_left != BORDER_NONE;
+}
 
-    TableBorderStyle right = BORDER_NONE;
-    if (right_below != NULL)
-    {
-        right = get_border_above(default_below_border_above, right_below);
-        count_styles(right, &num_single, &num_double);
-    }
+static bool overrides_border_above(const struct Cell *cell)
+{
+    return cell->override_border_above && cell->border_above != BORDER_NONE;
+}
 
-    TableBorderStyle below = BORDER_NONE;
-    if (right_below != NULL)
+/*
+Summary: Counters of rows and cols are corrected by the borders that are hidden.
+    Counters include cells that are not printed by views, so views check the printed cells instead.
+*/
+static bool has_hline(const struct Render *render, size_t row_index)
+{
+    const struct Row *row = get_render_row(render, row_index);
+    if (render->ignore_spans)
     {
-        below = get_border_left(default_right_border_left, right_below);
-        count_styles(below, &num_single, &num_double);
+        if (row->border_above != BORDER_NONE) return true;
+        size_t num_cols = render->hide_last_col_hlines ? render->num_cols - 1 : render->num_cols;
+        for (size_t i = 0; i < num_cols; i++)
+        {
+            if (overrides_border_above(get_cell(render, row_index, i))) return true;
+        }
+        return false;
     }
 
-    TableBorderStyle left  = BORDER_NONE;
-    if (left_below != NULL)
+    int counter = row->border_above_counter;
+    if (render->hide_last_col_hlines && overrides_border_above(&row->cells[render->num_cols - 1])) counter--;
+    return counter > 0;
+}
+
+static bool has_vline(const struct Render *render, size_t col)
+{
+    if (render->ignore_spans)
     {
-        left = get_border_above(default_below_border_above, left_below);
-        count_styles(left, &num_single, &num_double);
+        if (render->table->borders_left[render->cols[col]] != BORDER_NONE) return true;
+        size_t num_rows = render->hide_last_row_vlines ? render->num_rows - 1 : render->num_rows;
+        for (size_t i = 0; i < num_rows; i++)
+        {
+            if (overrides_border_left(get_cell(render, i, col))) return true;
+        }
+        return false;
     }
 
+    int counter = render->table->border_left_counters[col];
+    if (render->hide_last_row_vlines && overrides_border_left(&get_render_row(render, render->num_rows - 1)->cells[col])) counter--;
+    return counter > 0;
+}
+
+static void count_styles(TableBorderStyle style, size_t *out_num_single, size_t *out_num_double)
+{
+    if (style == BORDER_SINGLE) (*out_num_single)++;
+    if (style == BORDER_DOUBLE) (*out_num_double)++;
+}
+
+// Border styles of the four lines that meet at an intersection, clockwise beginning at the top
+static void print_intersection_char(
+    const struct Glyphs *glyphs,
+    TableBorderStyle above,
+    TableBorderStyle right,
+    TableBorderStyle below,
+    TableBorderStyle left,
+    struct Output *out)
+{
+    size_t num_single = 0;
+    size_t num_double = 0;
+    count_styles(above, &num_single, &num_double);
+    count_styles(right, &num_single, &num_double);
+    count_styles(below, &num_single, &num_double);
+    count_styles(left, &num_single, &num_double);
+
     size_t index = 0;
     if (above != BORDER_NONE)
     {
@@ -362,119 +585,176 @@ static void print_intersection_char(
 
     if (num_double > num_single)
     {
-        fprintf(stream, "%s", BORDER_MATRIX_DOUBLE[BORDER_LOOKUP[index]]);
+        print_glyph(&glyphs->double_border[BORDER_LOOKUP[index]], out);
     }
     else
     {
-        fprintf(stream, "%s", BORDER_MATRIX_SINGLE[BORDER_LOOKUP[index]]);
+        print_glyph(&glyphs->single_border[BORDER_LOOKUP[index]], out);
     }
 }
 
-// Above row can be NULL, below row must not be NULL!
-static void print_row_border(Table *table,
-    struct Row *above_row,
-    struct Row *below_row,
-    size_t *line_indices,
-    size_t *col_widths,
-    size_t *row_heights,
-    FILE *stream)
+// Prints border above row with index row_index
+static void print_row_border(struct Render *render, size_t row_index)
 {
-    for (size_t i = 0; i < table->num_cols; i++)
+    struct Output *out = render->out;
+    for (size_t i = 0; i < render->num_cols; i++)
     {
         // Print vline-hline intersection
-        if (table->border_left_counters[i] > 0)
+        if (render->has_vline[i])
         {
-            print_intersection_char(table->borders_left[i],
-                below_row->border_above,
-                above_row != NULL ? &above_row->cells[i] : NULL,
-                i > 0 ? &below_row->cells[i - 1] : NULL,
-                &below_row->cells[i], stream);
+            switch_attr(render, ATTR_DEFAULT);
+            print_intersection_char(
+                &render->table->glyphs,
+                row_index > 0 ? get_border_left_at(render, row_index - 1, i) : BORDER_NONE,
+                get_border_above_at(render, row_index, i),
+                get_border_left_at(render, row_index, i),
+                i > 0 ? get_border_above_at(render, row_index, i - 1) : BORDER_NONE,
+                out);
         }
 
         // Print hline in between intersections (or content when cell has span_y > 1)
-        if (below_row->cells[i].parent == NULL || below_row->cells[i].parent->y == below_row->cells[i].y)
+        if (begins_in_row(render, row_index, i))
         {
-            switch (get_border_above(below_row->border_above, &below_row->cells[i]))
+            switch_attr(render, ATTR_DEFAULT);
+            switch (get_border_above_at(render, row_index, i))
             {
                 case BORDER_SINGLE:
-                    print_repeated(BORDER_MATRIX_SINGLE[HLINE_INDEX], col_widths[i], stream);
+                    print_repeated(&render->table->glyphs.single_border[HLINE_GLYPH], render->col_widths[i], out);
                     break;
                 case BORDER_DOUBLE:
-                    print_repeated(BORDER_MATRIX_DOUBLE[HLINE_INDEX], col_widths[i], stream);
+                    print_repeated(&render->table->glyphs.double_border[HLINE_GLYPH], render->col_widths[i], out);
                     break;
                 case BORDER_NONE:
-                    print_repeated(" ", col_widths[i], stream);
+                    out_spaces(out, render->col_widths[i]);
             }
         }
         else
         {
-            struct Cell *parent = below_row->cells[i].parent;
-            print_text(parent,
-                table->h_aligns[i],
-                table->v_aligns[i],
-                line_indices[i],
-                get_total_width(table, col_widths, parent),
-                get_total_height(table, row_heights, parent),
-                stream);
-            line_indices[i]++;
+            const struct Cell *parent = get_parent(render, row_index, i);
+            print_cell_line(render, parent, i, render->line_indices[i]);
+            render->line_indices[i]++;
             i += parent->span_x - 1;
         }
     }
-    fprintf(stream, "\n");
+    switch_attr(render, ATTR_DEFAULT);
+    out_write(out, "\n", 1);
 }
 
-static void override_superfluous_lines(Table *table, size_t last_col_width, size_t last_row_height)
+// Special cases: If last row/col is empty, all vlines/hlines in it are hidden
+static void hide_superfluous_lines(struct Render *render)
 {
-    // Special cases: If last row/col is empty, delete all vlines/hlines in it
-    if (last_col_width == 0)
+    render->hide_last_col_hlines = render->col_widths[render->num_cols - 1] == 0;
+    render->hide_last_row_vlines = render->row_heights[render->num_rows - 1] == 0;
+    for (size_t i = 0; i < render->num_cols; i++)
     {
-        struct Row *row = table->first_row;
-        table->curr_col = table->num_cols - 1;
-        while (row != NULL)
-        {
-            table->curr_row = row;
-            override_above_border(table, BORDER_NONE);
-            row = row->next_row;
-        }
-    }
-    else
-    {
-        struct Row *row = table->first_row;
-        while (row != NULL)
-        {
-            table->curr_row = row;
-            row = row->next_row;
-        }
-    }
-    // table->curr_row is last row now
-    if (last_row_height == 0)
-    {
-        for (size_t i = 0; i < table->num_cols; i++)
-        {
-            table->curr_col = i;
-            override_left_border(table, BORDER_NONE);
-        }
+        render->has_vline[i] = has_vline(render, i);
     }
 }
 
-static void add_text_cell(Table *table, char *text, bool needs_free)
+void *table_alloc(const Table *table, size_t size)
+{
+    return table->allocator.alloc(table->allocator.context, size);
+}
+
+void table_free(const Table *table, void *ptr)
+{
+    table->allocator.free(table->allocator.context, ptr);
+}
+
+#ifdef TABLE_STATS
+// Wrapped around user's allocator to count allocations, context is the table
+static void *counting_alloc(void *context, size_t size)
+{
+    Table *table = context;
+    STATS_ADD_ATOMIC(table, num_allocations, 1);
+    STATS_ADD_ATOMIC(table, bytes_allocated, size);
+    return table->user_allocator.alloc(table->user_allocator.context, size);
+}
+
+static void *counting_realloc(void *context, void *ptr, size_t size)
+{
+    Table *table = context;
+    STATS_ADD_ATOMIC(table, num_allocations, 1);
+    STATS_ADD_ATOMIC(table, bytes_allocated, size);
+    return table->user_allocator.realloc(table->user_allocator.context, ptr, size);
+}
+
+static void counting_free(void *context, void *ptr)
+{
+    Table *table = context;
+    table->user_allocator.free(table->user_allocator.context, ptr);
+}
+#endif
+
+static void set_plain_text(struct Cell *cell, char *text, size_t length, bool needs_free)
 {
-    struct Cell *cell = &table->curr_row->cells[table->curr_col];
     cell->is_set = true;
     cell->text_needs_free = needs_free;
     cell->text = text;
-    cell->text_height = get_text_height(text);
-    cell->text_width = get_text_width(text);
+    cell->text_length = length;
+    cell->text_height = 1;
+    cell->text_width = length;
+    cell->has_escapes = false;
+}
+
+void set_cell_text(struct Cell *cell, char *text, size_t length, bool needs_free)
+{
+    cell->is_set = true;
+    cell->text_needs_free = needs_free;
+    cell->text = text;
+    cell->text_length = length;
+    measure_text(text, length, &cell->text_height, &cell->text_width, &cell->has_escapes);
+}
+
+// True iff cell in col of curr_row is either set or spanned over
+static bool is_occupied(const Table *table, size_t col)
+{
+    return table->curr_row->cells[col].is_set || table->cursor_spans.covering[col] != NULL;
+}
+
+// Moves cursor to the first column at or after curr_col that is not occupied
+static void skip_occupied(Table *table)
+{
+    while (table->curr_col != TABLE_MAX_COLS && is_occupied(table, table->curr_col))
+    {
+        table->curr_col++;
+    }
+}
+
+// Plain texts are a single line without color codes, they are as wide as they are long
+static void insert_cell(Table *table, char *text, size_t length, bool needs_free, bool is_plain)
+{
+    STATS_TIMER_START(timer);
+    struct Cell *cell = &table->curr_row->cells[table->curr_col];
+    // Nested cells are not counted, their widths change with the nested tables
+    if (table->histograms != NULL && cell->is_set && cell->nested == NULL) remove_cell_width(table, cell);
+    if (cell->nested != NULL) remove_nested_cell(table, cell);
+    if (is_plain) set_plain_text(cell, text, length, needs_free);
+    else set_cell_text(cell, text, length, needs_free);
+    fit_fixed_width(table, cell);
+    if (table->histograms != NULL) add_cell_width(table, cell);
+    table->version++;
+    if (needs_free) table->resident_bytes += length;
+    STATS_ADD(table, num_cells, 1);
+    STATS_ADD(table, num_multiline_cells, cell->text_height > 1);
+    table->num_multiline_cells += cell->text_height > 1;
 
     if (table->curr_col >= table->num_cols)
     {
         table->num_cols = table->curr_col + 1;
     }
-
-    while (table->curr_col != TABLE_MAX_COLS && table->curr_row->cells[table->curr_col].is_set)
+    if (table->curr_col >= table->num_content_cols)
     {
-        table->curr_col++;
+        table->num_content_cols = table->curr_col + 1;
     }
+
+    skip_occupied(table);
+    STATS_TIMER_STOP(table, insertion_ns, timer);
+}
+
+void add_text_cell(Table *table, char *text, size_t length, bool needs_free)
+{
+    insert_cell(table, text, length, needs_free, false);
 }
 
 static void override_h_align_internal(struct Cell *cell, TableHAlign h_align)
@@ -489,18 +769,24 @@ static void override_v_align_internal(struct Cell *cell, TableVAlign v_align)
     cell->override_v_align = true;
 }
 
-static struct Row *malloc_row(size_t y)
+struct Row *malloc_row(Table *table)
 {
-    struct Row *res = calloc(1, sizeof(struct Row));
+    struct Row *res = table_alloc(table, sizeof(struct Row));
     if (res == NULL) return NULL;
+    init_row(res);
+    return res;
+}
+
+void init_row(struct Row *res)
+{
+    *res = (struct Row){ .next_row = NULL, .border_above = BORDER_NONE, .border_above_counter = 0 };
     for (size_t i = 0; i < TABLE_MAX_COLS; i++)
     {
         res->cells[i] = (struct Cell){
             .is_set                = false,
             .x                     = i,
-            .y                     = y,
-            .parent                = NULL,
             .text                  = NULL,
+            .text_length           = 0,
             .override_h_align      = false,
             .override_v_align      = false,
             .override_border_left  = false,
@@ -510,36 +796,112 @@ static struct Row *malloc_row(size_t y)
             .text_needs_free       = false
         };
     }
-    return res;
 }
 
 static struct Row *append_row(Table *table)
 {
-    struct Row *row = table->curr_row;
+    // Rows published in order of keys do not move last_row
+    struct Row *row = table->last_row;
     while (row->next_row != NULL)
     {
         row = row->next_row;
     }
-    row->next_row = malloc_row(table->num_rows);
+    row->next_row = malloc_row(table);
+    table->last_row = row->next_row;
     table->num_rows++;
+    table->version++;
+    table->resident_bytes += sizeof(struct Row);
     return row->next_row;
 }
 
+struct Row *get_next_row(const struct Row *row)
+{
+    return __atomic_load_n(&row->next_row, __ATOMIC_ACQUIRE);
+}
+
+// Sweep before the first row, no cell spans over anything
+void init_spans(struct SpanSweep *spans)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        spans->covering[i] = NULL;
+        spans->rows_left[i] = 0;
+    }
+}
+
+static void add_span(struct SpanSweep *spans, const struct Cell *cell)
+{
+    for (size_t i = cell->x; i < cell->x + cell->span_x; i++)
+    {
+        spans->covering[i] = cell;
+        spans->rows_left[i] = cell->span_y - 1;
+    }
+}
+
+/*
+Summary: Moves sweep to row, which has to follow the row it was at (or be the first row).
+    Costs O(TABLE_MAX_COLS) no matter how far spans reach.
+*/
+void advance_spans(struct SpanSweep *spans, const struct Row *row)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        if (spans->rows_left[i] > 0)
+        {
+            spans->rows_left[i]--;
+        }
+        else
+        {
+            spans->covering[i] = NULL;
+        }
+    }
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct Cell *cell = &row->cells[i];
+        if (cell->span_x > 1 || cell->span_y > 1) add_span(spans, cell);
+    }
+}
+
+/*
+Summary: Finds cell that spans over cell in col of row, sweep has to be at row.
+Returns: NULL when cell is not spanned over, cells are not spanned over by themselves
+*/
+const struct Cell *get_spanning_cell(const struct SpanSweep *spans, const struct Row *row, size_t col)
+{
+    const struct Cell *cell = spans->covering[col];
+    return cell != &row->cells[col] ? cell : NULL;
+}
+
+/*
+Summary: Moves sweep of the cursor to curr_row after the cursor jumped or rows were moved.
+    No span reaches over spilled rows, so the sweep starts over after the first row when rows are spilled.
+*/
+void reset_cursor_spans(Table *table)
+{
+    init_spans(&table->cursor_spans);
+    for (struct Row *row = table->first_row; row != NULL; row = row->next_row)
+    {
+        advance_spans(&table->cursor_spans, row);
+        if (row == table->curr_row) break;
+        if (row == table->first_row && get_num_spilled(table) > 0) init_spans(&table->cursor_spans);
+    }
+}
+
 static struct Cell *get_curr_cell(Table *table)
 {
     return &table->curr_row->cells[table->curr_col];
 }
 
-static void free_row(Table *table, struct Row *row)
+void free_row(Table *table, struct Row *row)
 {
     for (size_t i = 0; i < table->num_cols; i++)
     {
         if (row->cells[i].text_needs_free)
         {
-            free(row->cells[i].text);
+            table_free(table, row->cells[i].text);
         }
     }
-    free(row);
+    table_free(table, row);
 }
 
 static size_t needed_to_satisfy(struct Constraint *constr, size_t *vars)
@@ -552,8 +914,8 @@ static size_t needed_to_satisfy(struct Constraint *constr, size_t *vars)
     return sum < constr->min ? constr->min - sum : 0;
 }
 
-// Make sure to zero out result before
-static void satisfy_constraints(size_t num_constrs, struct Constraint *constrs, size_t *result)
+// Make sure to zero out result before, or start from sizes that are to be widened
+void satisfy_constraints(size_t num_constrs, struct Constraint *constrs, size_t *result)
 {
     // Current heuristic: Do simple cells before...
     for (size_t i = 0; i < num_constrs; i++)
@@ -586,76 +948,180 @@ static void satisfy_constraints(size_t num_constrs, struct Constraint *constrs,
     }
 }
 
-void get_dimensions(Table *table, size_t *out_col_widths, size_t *out_row_heights)
+// Size of text of cell in layout, limited by its col
+void get_cell_size(const Table *table, const struct Cell *cell, size_t *out_width, size_t *out_height)
+{
+    if (has_limits(table, cell))
+    {
+        get_limited_size(table, cell, out_width, out_height);
+    }
+    else
+    {
+        *out_width = cell->text_width;
+        *out_height = cell->text_height;
+    }
+}
+
+// Constraint of width is weakened by the vlines it spans over
+static size_t weaken_width(const Table *table, size_t min, size_t from_index, size_t to_index)
+{
+    for (size_t j = from_index + 1; j < to_index; j++)
+    {
+        if (min == 0) break;
+        if (table->border_left_counters[j] > 0) min--;
+    }
+    return min;
+}
+
+/*
+Summary: Spilled rows are not read, their widths were recorded when they were spilled.
+    They add the same constraints as their cells would have, in the same order.
+Returns: Number of constraints added to constrs
+*/
+static size_t add_spilled_widths(const struct Render *render, struct Constraint *constrs)
 {
-    struct Constraint *constrs = malloc(table->num_cols * table->num_rows * sizeof(struct Constraint));
+    const struct Spill *spill = render->table->spill;
+    size_t index = 0;
+    for (size_t i = 0; i < render->num_cols; i++)
+    {
+        constrs[index++] = (struct Constraint){ .min = spill->col_widths[i], .from_index = i, .to_index = i + 1 };
+    }
+    for (size_t i = 0; i < vec_count(&spill->span_widths); i++)
+    {
+        const struct SpanSize *span = vec_get(&spill->span_widths, i);
+        constrs[index++] = (struct Constraint){
+            .min        = weaken_width(render->table, span->size, span->from_index, span->to_index),
+            .from_index = span->from_index,
+            .to_index   = span->to_index
+        };
+    }
+    return index;
+}
+
+// Widths of cells are counted by tables with a row capacity, they are the widths of cols when nothing else adds to them
+static bool has_width_histograms(const struct Render *render)
+{
+    const Table *table = render->table;
+    if (table->histograms == NULL || render->ignore_spans || render->num_spilled > 0) return false;
+    if (table->num_spanning_cells > 0 || vec_count(&table->nested_cells) > 0) return false;
+    for (size_t i = 0; i < render->num_cols; i++)
+    {
+        if (table->max_widths[i] != 0 || table->max_lines[i] != 0) return false;
+    }
+    return true;
+}
+
+static void get_dimensions(const struct Render *render, size_t *out_col_widths, size_t *out_row_heights)
+{
+    const Table *table = render->table;
+    size_t num_rows = render->num_rows;
+    size_t num_cols = render->num_cols;
+    size_t num_spilled = render->num_spilled;
+    // Fixed widths take a constraint per col
+    size_t num_constrs = num_cols * (num_rows - num_spilled + 1);
+    if (num_spilled > 0)
+    {
+        num_constrs += num_cols + vec_count(&table->spill->span_widths) + vec_count(&table->spill->span_heights);
+    }
+    struct Constraint *constrs = table_alloc(table, num_constrs * sizeof(struct Constraint));
     // Satisfy constraints of width
-    struct Row *curr_row = table->first_row;
     size_t index = 0;
-    while (curr_row != NULL)
+    bool has_histograms = has_width_histograms(render);
+    for (size_t i = 0; i < num_cols; i++)
+    {
+        size_t fixed_width = table->fixed_widths[render->cols[i]];
+        if (fixed_width != 0) constrs[index++] = (struct Constraint){ .min = fixed_width, .from_index = i, .to_index = i + 1 };
+    }
+    for (size_t i = 0; has_histograms && i < num_cols; i++)
+    {
+        constrs[index++] = (struct Constraint){ .min = get_max_cell_width(table, i), .from_index = i, .to_index = i + 1 };
+    }
+    for (size_t row_index = 0; row_index < num_rows && !has_histograms; row_index++)
     {
-        for (size_t i = 0; i < table->num_cols; i++)
+        if (row_index == 1 && num_spilled > 0)
         {
-            // Build constraints for set parent cells
-            if (curr_row->cells[i].is_set && curr_row->cells[i].parent == NULL)
+            index += add_spilled_widths(render, constrs + index);
+            row_index += num_spilled;
+        }
+        for (size_t i = 0; i < num_cols; i++)
+        {
+            // Build constraints for set cells, spanned-over cells are never set
+            const struct Cell *cell = get_cell(render, row_index, i);
+            size_t span_x = render->ignore_spans ? 1 : cell->span_x;
+            // Cells of cols with a fixed width fit into it, except nested tables, whose widths change
+            if (cell->is_set && (cell->span_x > 1 || table->fixed_widths[cell->x] == 0 || cell->nested != NULL))
             {
-                size_t min = curr_row->cells[i].text_width;
-
-                // Constraint can be weakened when vlines are in between
-                for (size_t j = i + 1; j < i + curr_row->cells[i].span_x; j++)
-                {
-                    if (min == 0) break;
-                    if (table->border_left_counters[j] > 0) min--;
-                }
-
+                size_t min;
+                size_t height;
+                get_cell_size(table, cell, &min, &height);
                 constrs[index] = (struct Constraint){
-                    .min        = min,
+                    .min        = weaken_width(table, min, i, i + span_x),
                     .from_index = i,
-                    .to_index   = i + curr_row->cells[i].span_x
+                    .to_index   = i + span_x
                 };
                 index++;
             }
         }
-        curr_row = curr_row->next_row;
     }
-    for (size_t i = 0; i < table->num_cols; i++) out_col_widths[i] = 0;
-    satisfy_constraints(index, constrs, out_col_widths);
+    if (table->layout != NULL && !render->ignore_spans)
+    {
+        apply_layout(table->layout, index, constrs, num_cols, out_col_widths);
+    }
+    else
+    {
+        for (size_t i = 0; i < num_cols; i++) out_col_widths[i] = 0;
+        satisfy_constraints(index, constrs, out_col_widths);
+    }
 
-    // Satisfy constraints of height
-    curr_row = table->first_row;
+    // Satisfy constraints of height, spilled rows begin with the height of their cells spanning a single row
+    for (size_t i = 0; i < num_rows; i++) out_row_heights[i] = 0;
+    for (size_t i = 0; i < num_spilled; i++) out_row_heights[i + 1] = *(size_t*)vec_get(&table->spill->row_heights, i);
     index = 0;
-    size_t row_index = 0;
-    while (curr_row != NULL)
+    for (size_t row_index = 0; row_index < num_rows; row_index++)
     {
-        for (size_t i = 0; i < table->num_cols; i++)
+        if (row_index == 1 && num_spilled > 0)
         {
-            if (curr_row->cells[i].is_set && curr_row->cells[i].parent == NULL)
+            // Spans of spilled rows end before the first row in memory that follows them
+            for (size_t i = 0; i < vec_count(&table->spill->span_heights); i++)
             {
-                size_t min = curr_row->cells[i].text_height;
-                struct Row *row_checked_for_hline = curr_row->next_row;
+                const struct SpanSize *span = vec_get(&table->spill->span_heights, i);
+                constrs[index++] = (struct Constraint){
+                    .min        = span->size,
+                    .from_index = span->from_index,
+                    .to_index   = span->to_index
+                };
+            }
+            row_index += num_spilled;
+        }
+        for (size_t i = 0; i < num_cols; i++)
+        {
+            const struct Cell *cell = get_cell(render, row_index, i);
+            if (cell->is_set)
+            {
+                size_t width;
+                size_t min;
+                get_cell_size(table, cell, &width, &min);
+                size_t span_y = render->ignore_spans ? 1 : cell->span_y;
+                if (row_index + span_y > num_rows) span_y = num_rows - row_index;
 
                 // Constraint can be weakened when hlines are in between
-                for (size_t j = i + 1; j < i + curr_row->cells[i].span_y; j++)
+                for (size_t j = 1; j < span_y; j++)
                 {
-                    if (row_checked_for_hline == NULL || min == 0) break;
-                    if (row_checked_for_hline->border_above_counter > 0) min--;
-                    row_checked_for_hline = row_checked_for_hline->next_row;
+                    if (min == 0) break;
+                    if (get_render_row(render, row_index + j)->border_above_counter > 0) min--;
                 }
 
                 constrs[index] = (struct Constraint){
                     .min        = min,
                     .from_index = row_index,
-                    .to_index   = row_index + curr_row->cells[i].span_y
+                    .to_index   = row_index + span_y
                 };
                 index++;
             }
         }
-        curr_row = curr_row->next_row;
-        row_index++;
     }
-    for (size_t i = 0; i < table->num_rows; i++) out_row_heights[i] = 0;
     satisfy_constraints(index, constrs, out_row_heights);
-    free(constrs);
+    table_free(table, constrs);
 }
 
 // ~ ~ ~ ~ ~ ~ ~ ~ ~ ~ User-functions ~ ~ ~ ~ ~ ~ ~ ~ ~ ~
@@ -665,19 +1131,60 @@ Returns: A new table with a single, empty row.
 */
 Table *get_empty_table()
 {
-    Table *res = malloc(sizeof(Table));
-    struct Row *first_row = malloc_row(0);
+    return get_empty_table_with_allocator(&DEFAULT_ALLOCATOR);
+}
+
+/*
+Summary: Like get_empty_table, but all memory of the table (including texts of add_cell_fmt) is obtained from allocator.
+    Texts passed to add_cell_gc are freed with it as well.
+*/
+Table *get_empty_table_with_allocator(const Allocator *allocator)
+{
+    assert(allocator != NULL);
+    Table *res = allocator->alloc(allocator->context, sizeof(Table));
     *res = (Table){
         .num_cols             = 0,
+        .num_content_cols     = 0,
         .curr_col             = 0,
-        .first_row            = first_row,
-        .curr_row             = first_row,
+        .first_row            = NULL,
+        .last_row             = NULL,
+        .curr_row             = NULL,
         .num_rows             = 1,
         .h_aligns             = { H_ALIGN_LEFT },
         .v_aligns             = { V_ALIGN_TOP },
         .borders_left         = { BORDER_NONE },
-        .border_left_counters = { 0 }
+        .border_left_counters = { 0 },
+        .attrs                = { ATTR_DEFAULT },
+        .max_widths           = { 0 },
+        .max_lines            = { 0 },
+        .fixed_widths         = { 0 },
+        .overflows            = { OVERFLOW_TRUNCATE },
+        .compact_mode         = COMPACT_NONE,
+        .spill                = NULL,
+        .resident_bytes       = 0,
+        .allocator            = *allocator
+    };
+#ifdef TABLE_STATS
+    res->user_allocator = *allocator;
+    res->allocator = (Allocator){
+        .alloc   = counting_alloc,
+        .realloc = counting_realloc,
+        .free    = counting_free,
+        .context = res
     };
+    STATS_ADD(res, num_allocations, 1);
+    STATS_ADD(res, bytes_allocated, sizeof(Table));
+#endif
+    res->mappings = vec_create_with_allocator(sizeof(struct Mapping), 1, &res->allocator);
+    res->nested_cells = vec_create_with_allocator(sizeof(struct Cell*), 1, &res->allocator);
+    res->style_rules = vec_create_with_allocator(sizeof(struct StyleRule), 1, &res->allocator);
+    res->retired_rows = vec_create_with_allocator(sizeof(struct Row*), 1, &res->allocator);
+    res->first_row = malloc_row(res);
+    res->resident_bytes = sizeof(struct Row);
+    res->curr_row = res->first_row;
+    res->last_row = res->first_row;
+    init_spans(&res->cursor_spans);
+    set_border_glyphs(res, GLYPHS_BOX);
     return res;
 }
 
@@ -696,9 +1203,71 @@ void free_table(Table *table)
         free_row(table, row);
         row = next_row;
     }
-    free(table);
+
+    for (size_t i = 0; i < vec_count(&table->mappings); i++)
+    {
+        struct Mapping *mapping = vec_get(&table->mappings, i);
+        munmap(mapping->address, mapping->length);
+    }
+    vec_destroy(&table->mappings);
+    vec_destroy(&table->nested_cells);
+    vec_destroy(&table->style_rules);
+    free_retired_rows(table);
+    vec_destroy(&table->retired_rows);
+    free_nesting(table);
+    free_histograms(table);
+    free_spill(table, table->spill);
+    // Table contains its allocator
+#ifdef TABLE_STATS
+    Allocator allocator = table->user_allocator;
+#else
+    Allocator allocator = table->allocator;
+#endif
+    allocator.free(allocator.context, table);
+}
+
+#ifdef TABLE_STATS
+uint64_t stats_now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+#endif
+
+/*
+Summary: Copies counters and timings of last print into out_stats.
+Returns: False when library was compiled without -DTABLE_STATS, out_stats is zeroed then
+*/
+bool table_get_stats(const Table *table, TableStats *out_stats)
+{
+    assert(table != NULL);
+    assert(out_stats != NULL);
+#ifdef TABLE_STATS
+    *out_stats = table->stats;
+    out_stats->num_rows = table->num_rows;
+    out_stats->num_spilled_rows = get_num_spilled(table);
+    return true;
+#else
+    (void)table;
+    *out_stats = (TableStats){ 0 };
+    return false;
+#endif
+}
+
+/*
+Summary: Enables modes that minimize whitespace printed by fprint_table, table_render_into and table_freeze.
+*/
+void set_compact_output(Table *table, TableCompactMode mode)
+{
+    assert(table != NULL);
+    table->compact_mode = mode;
+    table->version++;
 }
 
+/*
+Summary: Moves cursor to col x of row y, rows are appended up to y. Spilled rows can not be moved to.
+*/
 void set_position(Table *table, size_t x, size_t y)
 {
     assert(table != NULL);
@@ -715,7 +1284,9 @@ void set_position(Table *table, size_t x, size_t y)
         {
             table->curr_row = append_row(table);
         }
+        if (table->row_capacity != 0) evict_rows(table);
     }
+    reset_cursor_spans(table);
 }
 
 /*
@@ -727,18 +1298,19 @@ void next_row(Table *table)
 
     // Extend linked list if necessary
     table->curr_col = 0;
+    if (table->curr_row == table->first_row && get_num_spilled(table) > 0) init_spans(&table->cursor_spans);
     if (table->curr_row->next_row == NULL)
     {
         table->curr_row = append_row(table);
+        if (table->row_capacity != 0) evict_rows(table);
     }
     else
     {
         table->curr_row = table->curr_row->next_row;
-        while (table->curr_col < TABLE_MAX_COLS && table->curr_row->cells[table->curr_col].is_set)
-        {
-            table->curr_col++;
-        }
     }
+    advance_spans(&table->cursor_spans, table->curr_row);
+    skip_occupied(table);
+    if (table->spill != NULL && table->resident_bytes > table->spill->budget) spill_rows(table);
 }
 
 /*
@@ -747,7 +1319,22 @@ Summary: Adds next cell. Buffer is not copied. print_table will access it.
 */
 void add_cell(Table *table, const char *text)
 {
-    add_text_cell(table, (char*)text, false);
+    add_text_cell(table, (char*)text, text != NULL ? strlen(text) : 0, false);
+}
+
+/*
+Summary: Adds next cell with a copy of length bytes of text, which have to be a single line without color codes.
+    Such texts are as wide as they are long, so they are not measured (e.g. formatted numbers).
+*/
+void add_cell_plain(Table *table, const char *text, size_t length)
+{
+    assert(table != NULL);
+    assert(text != NULL);
+    assert(memchr(text, '\n', length) == NULL && memchr(text, '\033', length) == NULL);
+    char *copy = table_alloc(table, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    insert_cell(table, copy, length, true, true);
 }
 
 void add_cells(Table *table, size_t num_cells, ...)
@@ -766,12 +1353,12 @@ Summary: Same as add_cell, but frees buffer on reset
 */
 void add_cell_gc(Table *table, char *text)
 {
-    add_text_cell(table, text, true);
+    add_text_cell(table, text, text != NULL ? strlen(text) : 0, true);
 }
 
 void add_empty_cell(Table *table)
 {
-    add_text_cell(table, NULL, false);
+    add_text_cell(table, NULL, 0, false);
 }
 
 /*
@@ -786,11 +1373,26 @@ void add_cell_fmt(Table *table, const char *fmt, ...)
     va_end(args);
 }
 
+// Returns: Text allocated with allocator of table
+char *format_text(const Table *table, const char *fmt, va_list args, size_t *out_length)
+{
+    // Measure first to allocate exactly once
+    va_list args_copy;
+    va_copy(args_copy, args);
+    *out_length = vsnprintf(NULL, 0, fmt, args);
+    char *text = table_alloc(table, *out_length + 1);
+    vsnprintf(text, *out_length + 1, fmt, args_copy);
+    va_end(args_copy);
+    return text;
+}
+
 void add_cell_vfmt(Table *table, const char *fmt, va_list args)
 {
-    StringBuilder builder = strb_create(0);
-    vstrb_append(&builder, fmt, args);
-    add_text_cell(table, builder.buffer, true);
+    STATS_TIMER_START(timer);
+    size_t length;
+    char *text = format_text(table, fmt, args, &length);
+    STATS_TIMER_STOP(table, insertion_ns, timer);
+    add_text_cell(table, text, length, true);
 }
 
 /*
@@ -823,6 +1425,7 @@ void set_default_alignments(Table *table, size_t num_alignments, const TableHAli
         if (h_aligns != NULL) table->h_aligns[i] = h_aligns[i];
         if (v_aligns != NULL) table->v_aligns[i] = v_aligns[i];
     }
+    table->version++;
 }
 
 /*
@@ -832,12 +1435,14 @@ void override_horizontal_alignment(Table *table, TableHAlign h_align)
 {
     assert(table != NULL);
     override_h_align_internal(get_curr_cell(table), h_align);
+    table->version++;
 }
 
 void override_vertical_alignment(Table *table, TableVAlign v_align)
 {
     assert(table != NULL);
     override_v_align_internal(get_curr_cell(table), v_align);
+    table->version++;
 }
 
 /*
@@ -850,6 +1455,7 @@ void override_horizontal_alignment_of_row(Table *table, TableHAlign h_align)
     {
         override_h_align_internal(&table->curr_row->cells[i], h_align);
     }
+    table->version++;
 }
 
 void override_vertical_alignment_of_row(Table *table, TableVAlign v_align)
@@ -859,6 +1465,45 @@ void override_vertical_alignment_of_row(Table *table, TableVAlign v_align)
     {
         override_v_align_internal(&table->curr_row->cells[i], v_align);
     }
+    table->version++;
+}
+
+/*
+Summary: Sets default style of all cells in col
+*/
+void set_default_style(Table *table, size_t col, TableStyle style)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    table->attrs[col] = encode_style(style);
+    table->version++;
+}
+
+/*
+Summary: Overrides style of current cell
+*/
+void override_style(Table *table, TableStyle style)
+{
+    assert(table != NULL);
+    struct Cell *cell = get_curr_cell(table);
+    cell->attr = encode_style(style);
+    cell->override_attr = true;
+    table->version++;
+}
+
+/*
+Summary: Overrides style of all cells in current row
+*/
+void override_style_of_row(Table *table, TableStyle style)
+{
+    assert(table != NULL);
+    uint16_t attr = encode_style(style);
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        table->curr_row->cells[i].attr = attr;
+        table->curr_row->cells[i].override_attr = true;
+    }
+    table->version++;
 }
 
 void set_hline(Table *table, TableBorderStyle style)
@@ -873,6 +1518,7 @@ void set_hline(Table *table, TableBorderStyle style)
         table->curr_row->border_above_counter++;
     }
     table->curr_row->border_above = style;
+    table->version++;
 }
 
 void set_vline(Table *table, size_t index, TableBorderStyle style)
@@ -894,6 +1540,7 @@ void set_vline(Table *table, size_t index, TableBorderStyle style)
     }
 
     table->borders_left[index] = style;
+    table->version++;
 }
 
 void make_boxed(Table *table, TableBorderStyle style)
@@ -922,6 +1569,8 @@ void override_left_border(Table *table, TableBorderStyle style)
 
     get_curr_cell(table)->border_left = style;
     get_curr_cell(table)->override_border_left = true;
+    table->num_border_overrides++;
+    table->version++;
 }
 
 void override_above_border(Table *table, TableBorderStyle style)
@@ -939,10 +1588,12 @@ void override_above_border(Table *table, TableBorderStyle style)
 
     get_curr_cell(table)->border_above = style;
     get_curr_cell(table)->override_border_above = true;
+    table->num_border_overrides++;
+    table->version++;
 }
 
 /*
-Summary: Changes span of current cell
+Summary: Changes span of current cell. Only the current cell stores the span, rows are not created for it.
     When spanning cell clashes with already set cells, the span will be truncated
 */
 void set_span(Table *table, size_t span_x, size_t span_y)
@@ -954,54 +1605,43 @@ void set_span(Table *table, size_t span_x, size_t span_y)
     struct Cell *cell = &table->curr_row->cells[table->curr_col];
     assert(cell->span_x == 1);
     assert(cell->span_y == 1);
+    // Rows spilled after the first row can not be spanned over
+    assert(span_y == 1 || table->curr_row != table->first_row || get_num_spilled(table) == 0);
+    // Rows are evicted and deleted one by one
+    assert(span_y == 1 || table->row_capacity == 0);
 
-    cell->span_x = span_x;
-    cell->span_y = span_y;
-    table->num_cols = MAX(table->curr_col + span_x, table->num_cols);
-
-    // Inserts rows and sets child cells
+    // Truncate span at the first clash with a set or spanned-over cell in the rows that exist
+    struct SpanSweep spans = table->cursor_spans;
     struct Row *row = table->curr_row;
-    for (size_t i = 0; i < span_y; i++)
+    for (size_t i = 0; i < span_y && row != NULL; i++)
     {
         for (size_t j = 0; j < span_x; j++)
         {
             if (i == 0 && j == 0) continue;
-            struct Cell *child = &row->cells[cell->x + j];
-
-            if (!child->is_set)
+            const struct Cell *child = &row->cells[cell->x + j];
+            if (child->is_set || get_spanning_cell(&spans, row, cell->x + j) != NULL)
             {
-                child->is_set = true;
-                child->parent = cell;
-                
-                if (j != 0)
-                {
-                    child->border_left = BORDER_NONE;
-                    child->override_border_left = true;
-                }
-                if (i != 0)
+                if (i == 0)
                 {
-                    child->border_above = BORDER_NONE;
-                    child->override_border_above = true;
+                    span_x = j;
                 }
-            }
-            else
-            {
-                // Span clashes with already set cell, truncate it and finalize method
-                cell->span_y = i;
-                cell->span_x = j;
-                return;
+                span_y = MAX(i, 1);
+                break;
             }
         }
 
-        if (i + 1 < span_y && row->next_row == NULL)
-        {
-            row = append_row(table);
-        }
-        else
-        {
-            row = row->next_row;
-        }
+        row = row->next_row;
+        if (row != NULL) advance_spans(&spans, row);
     }
+
+    cell->span_x = span_x;
+    cell->span_y = span_y;
+    STATS_ADD(table, num_spans, 1);
+    table->num_spanning_cells += span_x > 1 || span_y > 1;
+    table->version++;
+    table->num_cols = MAX(table->curr_col + span_x, table->num_cols);
+    table->num_content_cols = MAX(table->curr_col + span_x, table->num_content_cols);
+    add_span(&table->cursor_spans, cell);
 }
 
 void set_all_vlines(Table *table, TableBorderStyle style)
@@ -1016,109 +1656,528 @@ void set_all_vlines(Table *table, TableBorderStyle style)
 
 // Printing
 
+/*
+Summary: Takes snapshot of rows that are printed. Rows can be published concurrently,
+    so only those linked when the list is walked are taken (a consistent prefix).
+    Spilled rows are read from the mapping of the file while printing.
+*/
+static void snapshot_rows(struct Render *render)
+{
+    Table *table = render->table;
+    render->spilled = open_spill_reader(table);
+    render->num_spilled = render->spilled != NULL ? get_num_spilled(table) : 0;
+    size_t count = 0;
+    for (struct Row *row = table->first_row; row != NULL; row = get_next_row(row)) count++;
+
+    render->rows = table_alloc(table, count * sizeof(struct Row*));
+    struct Row *row = table->first_row;
+    for (size_t i = 0; i < count; i++)
+    {
+        render->rows[i] = row;
+        row = get_next_row(row);
+    }
+    render->num_rows = render->num_spilled + count;
+    render->num_cols = __atomic_load_n(&table->num_cols, __ATOMIC_ACQUIRE);
+}
+
+static void release_snapshot(struct Render *render)
+{
+    table_free(render->table, render->rows);
+    close_spill_reader(render->spilled);
+}
+
 #ifdef DEBUG
 __attribute__((unused))
-static void print_debug(Table *table)
+static void print_debug(struct Render *render)
 {
-    size_t col_widths[TABLE_MAX_COLS];
-    size_t *row_heights = malloc(table->num_rows * sizeof(size_t));
-    get_dimensions(table, col_widths, row_heights);
-
-    printf("Table dimensions: #rows: %zu, #cols: %zu\n", table->num_rows, table->num_cols);
-    for (size_t i = 0; i < table->num_rows; i++) printf("%zu ", row_heights[i]);
+    printf("Table dimensions: #rows: %zu, #cols: %zu\n", render->num_rows, render->num_cols);
+    for (size_t i = 0; i < render->num_rows; i++) printf("%zu ", render->row_heights[i]);
     printf("; ");
-    for (size_t i = 0; i < table->num_cols; i++) printf("%zu ", col_widths[i]);
+    for (size_t i = 0; i < render->num_cols; i++) printf("%zu ", render->col_widths[i]);
     printf("\n");
-    free(row_heights);
 }
 #endif
 
 /*
-Summary: Prints table to stdout
+Summary: Checks whether every line of content can be printed by print_simple_line and resolves its vlines.
+    Counters of the table only grow, so a table that had a span or multi-line cell once stays on the general path.
 */
-void print_table(Table *table)
+static void prepare_simple(struct Render *render)
 {
-    assert(table != NULL);
-    fprint_table(table, stdout);
+    Table *table = render->table;
+    render->is_simple = !render->ignore_spans
+        && __atomic_load_n(&table->num_spanning_cells, __ATOMIC_RELAXED) == 0
+        && __atomic_load_n(&table->num_multiline_cells, __ATOMIC_RELAXED) == 0
+        && __atomic_load_n(&table->num_border_overrides, __ATOMIC_RELAXED) == 0;
+    for (size_t i = 0; i < render->num_cols && render->is_simple; i++)
+    {
+        size_t col = render->cols[i];
+        render->is_simple = table->max_widths[col] == 0 && table->max_lines[col] == 0;
+        switch (table->borders_left[col])
+        {
+            case BORDER_SINGLE:
+                render->vlines[i] = &table->glyphs.single_border[VLINE_GLYPH];
+                break;
+            case BORDER_DOUBLE:
+                render->vlines[i] = &table->glyphs.double_border[VLINE_GLYPH];
+                break;
+            case BORDER_NONE:
+                render->vlines[i] = NULL;
+        }
+    }
 }
 
-void fprint_table(Table *table, FILE *stream)
+/*
+Summary: Prepares printing rows and cols selected in render to target, render must not move until end_render.
+Returns: False if there is nothing to print
+*/
+static bool begin_render(struct Render *render, struct Output *target)
+{
+    Table *table = render->table;
+    render->target = target;
+    render->compactor = (struct Compactor){ .target = target, .mode = table->compact_mode };
+    render->compacting = output_compacting(&render->compactor);
+    render->out = table->compact_mode != COMPACT_NONE && !render->is_nested ? &render->compacting : target;
+    render->active_attr = ATTR_DEFAULT;
+    render->row_index = 0;
+    render->row_line = 0;
+    render->has_entered_row = false;
+    render->row_heights = NULL;
+
+    STATS_SET(table, dimensions_ns, 0);
+    STATS_SET(table, borders_ns, 0);
+    STATS_SET(table, content_ns, 0);
+    STATS_SET(table, total_ns, 0);
+    STATS_SET(table, bytes_emitted, 0);
+    if (render->num_cols == 0 || render->num_rows == 0) return false;
+
+    STATS_TIMER_START(total_timer);
+    STATS_TIMER_START(dimensions_timer);
+    update_nested_cells(table);
+    render->row_heights = table_alloc(table, render->num_rows * sizeof(size_t));
+    get_dimensions(render, render->col_widths, render->row_heights);
+    STATS_TIMER_STOP(table, dimensions_ns, dimensions_timer);
+
+    STATS_TIMER_START(override_timer);
+    hide_superfluous_lines(render);
+    STATS_TIMER_STOP(table, borders_ns, override_timer);
+    
+    //#ifdef DEBUG
+    //print_debug(render);
+    //#endif
+
+    for (size_t i = 0; i < render->num_cols; i++) render->line_indices[i] = 0;
+    init_spans(&render->spans);
+    prepare_simple(render);
+    STATS_TIMER_STOP(table, total_ns, total_timer);
+    return true;
+}
+
+// Prints border above row_index (if any) and prepares cells beginning in it
+static void enter_row(struct Render *render)
 {
-    if (table->num_cols == 0)
+    Table *table = render->table;
+    size_t row_index = render->row_index;
+    if (render->is_simple)
     {
+        // Nothing spans, so there are no spans to advance and every cell begins at its first line
+        if (has_hline(render, row_index))
+        {
+            STATS_TIMER_START(border_timer);
+            print_row_border(render, row_index);
+            STATS_TIMER_STOP(table, borders_ns, border_timer);
+        }
+        render->has_entered_row = true;
+        render->row_line = 0;
         return;
     }
 
-    size_t col_widths[TABLE_MAX_COLS];
-    size_t *row_heights = malloc(table->num_rows * sizeof(size_t));
-    get_dimensions(table, col_widths, row_heights);
-    override_superfluous_lines(table, col_widths[table->num_cols - 1], row_heights[table->num_rows - 1]);
-    
-    //#ifdef DEBUG
-    //print_debug(table);
-    //#endif
+    render->prev_spans = render->spans;
+    if (!render->ignore_spans) advance_spans(&render->spans, get_render_row(render, row_index));
 
-    size_t line_indices[TABLE_MAX_COLS];
-    for (size_t i = 0; i < table->num_cols; i++) line_indices[i] = 0;
+    if (has_hline(render, row_index))
+    {
+        STATS_TIMER_START(border_timer);
+        print_row_border(render, row_index);
+        STATS_TIMER_STOP(table, borders_ns, border_timer);
+    }
 
-    // Print rows
-    struct Row *prev_row = NULL;
-    struct Row *curr_row = table->first_row;
-    size_t row_index = 0;
-    while (curr_row != NULL)
+    // Reset line indices for newly beginning cells, don't reset them for cells that are children spanning from above
+    for (size_t j = 0; j < render->num_cols; j++)
     {
-        if (curr_row->border_above_counter > 0)
+        if (begins_in_row(render, row_index, j))
         {
-            print_row_border(table, prev_row, curr_row, line_indices, col_widths, row_heights, stream);
+            render->line_indices[j] = 0;
+            const struct Cell *cell = get_printed_cell(render, row_index, j);
+            render->total_heights[j] = get_total_height(render, row_index, cell);
+            apply_style_rules(table, cell, &render->attrs[j], &render->h_aligns[j]);
+            size_t width;
+            if (has_limits(table, cell)) get_limited_size(table, cell, &width, &render->cell_heights[j]);
         }
+    }
+    render->has_entered_row = true;
+    render->row_line = 0;
+}
 
-        // Reset line indices for newly beginning cells, don't reset them for cells that are children spanning from above
-        for (size_t j = 0; j < table->num_cols; j++)
+// Prints a line of cell content of row_index
+static void print_content_line(struct Render *render)
+{
+    Table *table = render->table;
+    struct Output *out = render->out;
+    size_t row_index = render->row_index;
+    for (size_t k = 0; k < render->num_cols; k += get_span_x(render, row_index, k))
+    {
+        if (render->has_vline[k])
         {
-            if (curr_row->cells[j].parent == NULL || curr_row->cells[j].y == curr_row->cells[j].parent->y)
+            switch_attr(render, ATTR_DEFAULT);
+            switch (get_border_left_at(render, row_index, k))
             {
-                line_indices[j] = 0;
+                case BORDER_SINGLE:
+                    print_glyph(&table->glyphs.single_border[VLINE_GLYPH], out);
+                    break;
+                case BORDER_DOUBLE:
+                    print_glyph(&table->glyphs.double_border[VLINE_GLYPH], out);
+                    break;
+                case BORDER_NONE:
+                    out_write(out, " ", 1);
             }
         }
 
-        for (size_t j = 0; j < row_heights[row_index]; j++)
+        print_cell_line(render, get_printed_cell(render, row_index, k), k, render->line_indices[k]);
+        render->line_indices[k]++;
+    }
+
+    switch_attr(render, ATTR_DEFAULT);
+    out_write(out, "\n", 1);
+    render->row_line++;
+}
+
+/*
+Summary: Prints the only line of content of row_index when render is simple. Output is the same as of
+    print_content_line, but cells are neither looked up through spans nor aligned vertically.
+*/
+static void print_simple_line(struct Render *render)
+{
+    const Table *table = render->table;
+    struct Output *out = render->out;
+    const struct Row *row = get_render_row(render, render->row_index);
+    for (size_t k = 0; k < render->num_cols; k++)
+    {
+        if (render->has_vline[k])
         {
-            // Print cell
-            for (size_t k = 0; k < table->num_cols; k += get_span_x(&curr_row->cells[k]))
+            switch_attr(render, ATTR_DEFAULT);
+            if (render->vlines[k] != NULL)
             {
-                if (table->border_left_counters[k] > 0)
-                {
-                    switch (get_border_left(table->borders_left[k], &curr_row->cells[k]))
-                    {
-                        case BORDER_SINGLE:
-                            fprintf(stream, "%s", BORDER_MATRIX_SINGLE[VLINE_INDEX]);
-                            break;
-                        case BORDER_DOUBLE:
-                            fprintf(stream, "%s", BORDER_MATRIX_DOUBLE[VLINE_INDEX]);
-                            break;
-                        case BORDER_NONE:
-                            fprintf(stream, " ");
-                    }
-                }
-
-                print_text(&curr_row->cells[k],
-                    table->h_aligns[k],
-                    table->v_aligns[k],
-                    line_indices[k],
-                    get_total_width(table, col_widths, &curr_row->cells[k]),
-                    get_total_height(table, row_heights, &curr_row->cells[k]),
-                    stream);
-                
-                line_indices[k]++;
+                print_glyph(render->vlines[k], out);
+            }
+            else
+            {
+                out_write(out, " ", 1);
             }
+        }
+
+        size_t col = render->cols[k];
+        const struct Cell *cell = &row->cells[col];
+        uint16_t default_attr;
+        TableHAlign default_h_align;
+        apply_style_rules(table, cell, &default_attr, &default_h_align);
+        uint16_t attr = get_attr(default_attr, cell);
+        switch_attr(render, attr);
+        if (cell->text == NULL)
+        {
+            out_spaces(out, render->col_widths[k]);
+            continue;
+        }
 
-            fprintf(stream, "\n");
+        // Spilled and loaded cells can be wider than their col, they overflow it like on the general path
+        size_t padding = render->col_widths[k] > cell->text_width ? render->col_widths[k] - cell->text_width : 0;
+        switch (get_h_align(default_h_align, cell))
+        {
+            case H_ALIGN_LEFT:
+                out_text(out, cell->text, cell->text_length);
+                out_spaces(out, padding);
+                break;
+            case H_ALIGN_RIGHT:
+                out_spaces(out, padding);
+                out_text(out, cell->text, cell->text_length);
+                break;
+            case H_ALIGN_CENTER:
+                out_spaces(out, padding / 2);
+                out_text(out, cell->text, cell->text_length);
+                out_spaces(out, padding - padding / 2);
+                break;
+        }
+        if (cell->has_escapes && attr != ATTR_DEFAULT) render->active_attr = ATTR_UNKNOWN;
+    }
+
+    switch_attr(render, ATTR_DEFAULT);
+    out_write(out, "\n", 1);
+    render->row_line++;
+}
+
+/*
+Summary: Prints the next line of output, which is either a border line or a line of content.
+    The position is kept in render, so printing can be resumed at any line.
+Returns: False if all lines were printed before
+*/
+static bool print_next_line(struct Render *render)
+{
+    Table *table = render->table;
+    STATS_TIMER_START(total_timer);
+    bool has_printed = false;
+    while (!has_printed && render->row_index < render->num_rows)
+    {
+        if (!render->has_entered_row)
+        {
+            size_t written = render->target->written;
+            enter_row(render);
+            has_printed = render->target->written != written;
+        }
+        else if (render->row_line < render->row_heights[render->row_index])
+        {
+            STATS_TIMER_START(content_timer);
+            if (render->is_simple)
+            {
+                print_simple_line(render);
+            }
+            else
+            {
+                print_content_line(render);
+            }
+            STATS_TIMER_STOP(table, content_ns, content_timer);
+            has_printed = true;
+        }
+        else
+        {
+            render->row_index++;
+            render->has_entered_row = false;
         }
+    }
+    STATS_TIMER_STOP(table, total_ns, total_timer);
+    return has_printed;
+}
+
+static void end_render(struct Render *render)
+{
+    Table *table = render->table;
+    if (render->row_heights != NULL) table_free(table, render->row_heights);
+    render->row_heights = NULL;
+    STATS_SET(table, bytes_emitted, render->target->written);
+}
+
+// Prints rows and cols selected in render
+static void print_render(struct Render *render, struct Output *target)
+{
+    if (begin_render(render, target))
+    {
+        while (print_next_line(render));
+    }
+    end_render(render);
+}
+
+void render_table(Table *table, struct Output *target)
+{
+    struct Render render = { .table = table };
+    snapshot_rows(&render);
+    for (size_t i = 0; i < render.num_cols; i++) render.cols[i] = i;
+    print_render(&render, target);
+    release_snapshot(&render);
+}
+
+// Computes the layout of table without printing it
+void measure_table(Table *table)
+{
+    struct Output out = output_counting();
+    struct Render render = { .table = table };
+    snapshot_rows(&render);
+    for (size_t i = 0; i < render.num_cols; i++) render.cols[i] = i;
+    begin_render(&render, &out);
+    end_render(&render);
+    release_snapshot(&render);
+}
+
+/*
+Summary: Prints table like render_table, but without compacting whitespace, so all lines are equally wide.
+Returns: Width of lines in columns
+*/
+size_t render_nested(Table *table, struct Output *target)
+{
+    struct Render render = { .table = table, .is_nested = true };
+    snapshot_rows(&render);
+    for (size_t i = 0; i < render.num_cols; i++) render.cols[i] = i;
+    size_t width = 0;
+    if (begin_render(&render, target))
+    {
+        for (size_t i = 0; i < render.num_cols; i++) width += render.has_vline[i] + render.col_widths[i];
+        while (print_next_line(&render));
+    }
+    end_render(&render);
+    release_snapshot(&render);
+    return width;
+}
+
+/*
+ * Pull-based rendering: Each call to table_render_next prints whole lines into the buffer of the caller.
+ * Only the part of the last line that does not fit is kept, so memory does not grow with the output.
+ */
+struct TableRenderIterator
+{
+    struct Render render;
+    struct Output out;     // Writes into chunk, spills into overflow when chunk is full
+    char *chunk;           // Buffer of current call to table_render_next
+    size_t chunk_capacity;
+    size_t chunk_length;
+    Vector overflow;       // Bytes of last printed line that did not fit into previous chunk
+    size_t overflow_start; // Bytes of overflow already handed out
+    bool has_lines;        // Whether render has lines left to print
+};
+
+static void write_to_chunk(struct Output *out, const char *bytes, size_t length)
+{
+    TableRenderIterator *it = out->context;
+    size_t fitting = MIN(length, it->chunk_capacity - it->chunk_length);
+    memcpy(it->chunk + it->chunk_length, bytes, fitting);
+    it->chunk_length += fitting;
+    if (fitting < length) vec_push_many(&it->overflow, length - fitting, (void*)(bytes + fitting));
+}
+
+/*
+Summary: Starts rendering table in chunks, the table must not be changed until table_render_end.
+    Rows published concurrently after this call are not rendered.
+*/
+TableRenderIterator *table_render_begin(Table *table)
+{
+    assert(table != NULL);
+    TableRenderIterator *it = table_alloc(table, sizeof(TableRenderIterator));
+    *it = (TableRenderIterator){
+        .render         = { .table = table },
+        .out            = { .write = write_to_chunk, .context = it },
+        .chunk          = NULL,
+        .chunk_capacity = 0,
+        .chunk_length   = 0,
+        .overflow       = vec_create_with_allocator(sizeof(char), 64, &table->allocator),
+        .overflow_start = 0
+    };
+    snapshot_rows(&it->render);
+    for (size_t i = 0; i < it->render.num_cols; i++) it->render.cols[i] = i;
+    it->has_lines = begin_render(&it->render, &it->out);
+    return it;
+}
 
-        row_index++;
-        prev_row = curr_row;
-        curr_row = curr_row->next_row;
+/*
+Summary: Renders the next up to size (> 0) bytes of table into buf, continuing where the previous call stopped.
+Returns: Number of bytes written to buf, 0 once the whole table was rendered
+*/
+size_t table_render_next(TableRenderIterator *it, char *buf, size_t size)
+{
+    assert(it != NULL);
+    assert(buf != NULL);
+    assert(size > 0);
+    it->chunk = buf;
+    it->chunk_capacity = size;
+    it->chunk_length = 0;
+
+    // Hand out rest of the last line first
+    size_t overflow_length = vec_count(&it->overflow) - it->overflow_start;
+    size_t taken = MIN(overflow_length, size);
+    if (taken > 0) memcpy(buf, (char*)it->overflow.buffer + it->overflow_start, taken);
+    it->chunk_length = taken;
+    it->overflow_start += taken;
+    if (it->overflow_start == vec_count(&it->overflow))
+    {
+        vec_clear(&it->overflow);
+        it->overflow_start = 0;
+    }
+
+    while (it->has_lines && vec_count(&it->overflow) == 0 && it->chunk_length < it->chunk_capacity)
+    {
+        it->has_lines = print_next_line(&it->render);
     }
+    return it->chunk_length;
+}
+
+void table_render_end(TableRenderIterator *it)
+{
+    assert(it != NULL);
+    Table *table = it->render.table;
+    end_render(&it->render);
+    release_snapshot(&it->render);
+    vec_destroy(&it->overflow);
+    table_free(table, it);
+}
+
+/*
+Summary: Prints only the given rows and cols of table, in their given order. Layout is computed over them only.
+    Spans are ignored, cells that are spanned over are printed empty.
+*/
+void render_selection(Table *table, struct Row **rows, size_t num_rows,
+    const size_t *cols, size_t num_cols, struct Output *target)
+{
+    assert(num_cols <= TABLE_MAX_COLS);
+    struct Render render = {
+        .table        = table,
+        .rows         = rows,
+        .num_rows     = num_rows,
+        .num_cols     = num_cols,
+        .ignore_spans = true
+    };
+    for (size_t i = 0; i < num_cols; i++) render.cols[i] = cols[i];
+    print_render(&render, target);
+}
+
+/*
+Summary: Prints table to stdout
+*/
+void print_table(Table *table)
+{
+    assert(table != NULL);
+    fprint_table(table, stdout);
+}
+
+void fprint_table(Table *table, FILE *stream)
+{
+    assert(table != NULL);
+    TableSink sink = get_stream_sink(stream);
+    print_table_to_sink(table, &sink);
+}
 
-    free(row_heights);
+/*
+Summary: Prints table to sink, writes are collected into chunks of up to TABLE_SINK_CHUNK_SIZE bytes.
+    Writes of at least that size, like long texts, are not copied but passed to sink directly. sink is flushed at the end.
+*/
+void print_table_to_sink(Table *table, const TableSink *sink)
+{
+    assert(table != NULL);
+    assert(sink != NULL && sink->write != NULL);
+    struct SinkBuffer buffer;
+    struct Output out = output_from_sink(&buffer, sink);
+    render_table(table, &out);
+    finish_sink(&buffer);
+}
+
+/*
+Returns: Exact number of bytes fprint_table would write, including bytes of border glyphs and color codes.
+    Bytes are counted like for a stream that is not a terminal, which is what table_render_into writes.
+    With COMPACT_CURSOR_FORWARD, printing to a terminal replaces runs of spaces and writes fewer bytes.
+*/
+size_t table_rendered_size(Table *table)
+{
+    assert(table != NULL);
+    struct Output out = output_counting();
+    render_table(table, &out);
+    return out.written;
+}
+
+/*
+Summary: Renders table into buffer without allocating any output memory. No \0 is appended.
+    When the table does not fit, output is truncated after size bytes.
+Returns: Number of bytes of the whole rendering (like snprintf), i.e. a result > size indicates truncation
+*/
+size_t table_render_into(Table *table, char *buf, size_t size)
+{
+    assert(table != NULL);
+    assert(buf != NULL || size == 0);
+    struct Output out = output_from_buffer(buf, size);
+    render_table(table, &out);
+    return out.written;
 }
@@ -2,6 +2,8 @@
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
+#include "allocator.h"
 
 // Can be changed without further modifications
 #define TABLE_MAX_COLS 11
@@ -27,26 +29,238 @@ typedef enum
     V_ALIGN_CENTER // Rounded to the top
 } TableVAlign;
 
+typedef enum
+{
+    COLOR_DEFAULT, // Color of terminal
+    COLOR_BLACK,
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_YELLOW,
+    COLOR_BLUE,
+    COLOR_MAGENTA,
+    COLOR_CYAN,
+    COLOR_WHITE,
+    COLOR_BRIGHT_BLACK,
+    COLOR_BRIGHT_RED,
+    COLOR_BRIGHT_GREEN,
+    COLOR_BRIGHT_YELLOW,
+    COLOR_BRIGHT_BLUE,
+    COLOR_BRIGHT_MAGENTA,
+    COLOR_BRIGHT_CYAN,
+    COLOR_BRIGHT_WHITE
+} TableColor;
+
+typedef enum
+{
+    SORT_LEXICOGRAPHIC,
+    SORT_NUMERIC,       // Numbers in ascending order, followed by other texts
+    SORT_CUSTOM         // Keys are compared with a TableCellComparator
+} TableSortKey;
+
+// Compares two texts like strcmp, texts are not \0-terminated
+typedef int (*TableCellComparator)(const char *a, size_t a_length, const char *b, size_t b_length);
+
+// Modes can be combined
+typedef enum
+{
+    COMPACT_NONE           = 0,
+    COMPACT_TRIM           = 1 << 0, // Trailing whitespace of lines is dropped
+    COMPACT_CURSOR_FORWARD = 1 << 1  // Long runs of spaces become cursor movements when printing to a terminal
+} TableCompactMode;
+
+typedef enum
+{
+    GLYPHS_BOX,     // Box-drawing characters (default)
+    GLYPHS_ASCII,   // +, -, = and |, a single byte each
+    GLYPHS_ROUNDED, // Box-drawing characters with rounded corners
+    GLYPHS_HEAVY    // Heavy box-drawing characters for single borders
+} TableGlyphSet;
+
+// Glyphs of a border style: ┌ ┬ ┐ ├ ┼ ┤ └ ┴ ┘ ─ │, each one column wide and at most 4 bytes long
+typedef struct
+{
+    const char *single_border[11];
+    const char *double_border[11];
+} TableBorderGlyphs;
+
+// How text is shown that does not fit into the maximum width of its column
+typedef enum
+{
+    OVERFLOW_TRUNCATE, // Lines are cut, an ellipsis marks the cut
+    OVERFLOW_WRAP      // Lines are broken at spaces, words longer than the width are split
+} TableOverflow;
+
+typedef struct
+{
+    TableColor foreground;
+    TableColor background;
+    bool bold;
+} TableStyle;
+
+typedef enum
+{
+    TABLE_FORMAT_CSV,
+    TABLE_FORMAT_TSV,
+    TABLE_FORMAT_MARKDOWN,
+    TABLE_FORMAT_NDJSON // First row is used as keys
+} TableFormat;
+
+// Only maintained when compiled with -DTABLE_STATS
+typedef struct
+{
+    size_t num_cells;           // Number of inserted cells
+    size_t num_rows;            // Number of rows
+    size_t num_spilled_rows;    // Number of rows moved to the spill file, see set_memory_budget
+    size_t num_spans;           // Number of cells spanning over others
+    size_t num_multiline_cells; // Number of cells with more than one line of text
+    size_t num_allocations;     // Number of allocations made for this table
+    size_t bytes_allocated;     // Sum of sizes of these allocations
+    size_t bytes_emitted;       // Bytes written by last print
+
+    // Monotonic time in nanoseconds
+    uint64_t insertion_ns;      // Spent in cell insertions in total
+    uint64_t dimensions_ns;     // Spent computing widths and heights in last print
+    uint64_t borders_ns;        // Spent resolving and writing border lines in last print
+    uint64_t content_ns;        // Spent writing lines with cell content in last print
+    uint64_t total_ns;          // Duration of last print
+} TableStats;
+
 typedef struct Table Table;
+typedef struct TableRowBuilder TableRowBuilder;
+typedef struct TablePlan TablePlan;
+typedef struct TableView TableView;
+typedef struct TableRenderer TableRenderer;
+typedef struct TableRenderIterator TableRenderIterator;
+typedef struct TableLayout TableLayout;
+
+// Called on the worker thread of renderer when output is ready, see table_renderer_take
+typedef void (*TableRenderCallback)(TableRenderer *renderer, void *context);
+
+// Text of a cell, not \0-terminated. text is NULL for unset cells.
+typedef struct
+{
+    const char *text;
+    size_t length;
+} TableText;
+
+// Receives output in chunks of up to TABLE_SINK_CHUNK_SIZE bytes, larger writes are passed through whole
+typedef struct
+{
+    void (*write)(void *context, const char *bytes, size_t length);
+    void (*flush)(void *context); // Optional, called once after a table was written completely
+    void *context;
+    bool is_terminal;             // Whether cursor movements can be written, see COMPACT_CURSOR_FORWARD
+} TableSink;
+
+#define TABLE_SINK_CHUNK_SIZE 16384
+
+// Decides whether a style rule applies to the text of a cell, text is not \0-terminated
+typedef bool (*TableCellPredicate)(const char *text, size_t length, void *context);
+
+typedef enum
+{
+    RULE_BELOW,   // Text is a number below threshold, surrounding spaces are ignored
+    RULE_ABOVE,   // Text is a number above threshold
+    RULE_PREFIX,  // Text begins with prefix
+    RULE_CALLBACK // predicate returns true
+} TableRuleKind;
+
+// Condition on the texts of a col and the style or alignment it gives matching cells
+typedef struct
+{
+    TableRuleKind kind;
+    double threshold;             // RULE_BELOW, RULE_ABOVE
+    const char *prefix;           // RULE_PREFIX, not copied
+    TableCellPredicate predicate; // RULE_CALLBACK
+    void *context;                // Passed to predicate
+    bool sets_style;
+    TableStyle style;
+    bool sets_h_align;
+    TableHAlign h_align;
+} TableStyleRule;
+
+// Decides whether row with row_index is shown in a view, cells contains num_cols texts
+typedef bool (*TableRowPredicate)(size_t row_index, const TableText *cells, size_t num_cols, void *context);
 
 // Data and printing
 Table *get_empty_table();
+Table *get_empty_table_with_allocator(const Allocator *allocator);
 void print_table(Table *table);
 void fprint_table(Table *table, FILE *stream);
+void print_table_to_sink(Table *table, const TableSink *sink);
+TableSink get_stream_sink(FILE *stream);
+size_t table_rendered_size(Table *table);
+size_t table_render_into(Table *table, char *buf, size_t size);
+TableRenderIterator *table_render_begin(Table *table);
+size_t table_render_next(TableRenderIterator *it, char *buf, size_t size);
+void table_render_end(TableRenderIterator *it);
+void fprint_table_as(Table *table, FILE *stream, TableFormat format);
 void free_table(Table *table);
+bool table_save(Table *table, const char *path);
+Table *table_load_mapped(const char *path);
+Table *table_load_mapped_with_allocator(const char *path, const Allocator *allocator);
+bool table_get_stats(const Table *table, TableStats *out_stats);
+void set_compact_output(Table *table, TableCompactMode mode);
+
+// Frozen printing
+TablePlan *table_freeze(Table *table);
+void fprint_table_plan(const TablePlan *plan, FILE *stream);
+size_t table_plan_size(const TablePlan *plan);
+size_t table_plan_render_into(const TablePlan *plan, char *buf, size_t size);
+void free_table_plan(TablePlan *plan);
+
+// Views
+TableView *get_table_view(Table *table);
+void view_select_rows(TableView *view, size_t num_rows, const size_t *row_indices);
+void view_filter_rows(TableView *view, TableRowPredicate predicate, void *context);
+void view_select_cols(TableView *view, size_t num_cols, const size_t *col_indices);
+void fprint_table_view(const TableView *view, FILE *stream);
+void free_table_view(TableView *view);
+
+// Rendering in the background
+TableRenderer *get_table_renderer(TableRenderCallback callback, void *context);
+TableRenderer *get_table_renderer_with_allocator(TableRenderCallback callback, void *context, const Allocator *allocator);
+void table_renderer_submit(TableRenderer *renderer, Table *table);
+int table_renderer_fd(const TableRenderer *renderer);
+bool table_renderer_take(TableRenderer *renderer, const char **out_output, size_t *out_length);
+void free_table_renderer(TableRenderer *renderer);
+
+// Shared layouts
+TableLayout *get_table_layout();
+TableLayout *get_table_layout_with_allocator(const Allocator *allocator);
+void table_use_layout(Table *table, TableLayout *layout);
+void free_table_layout(TableLayout *layout);
 
 // Control
 void set_position(Table *table, size_t x, size_t y);
 void next_row(Table *table);
+bool set_memory_budget(Table *table, size_t budget);
+void table_sort_rows(Table *table, size_t col, TableSortKey sort_key, TableCellComparator comparator,
+    size_t from_row, size_t to_row);
+void set_row_capacity(Table *table, size_t capacity);
+void table_insert_row(Table *table, size_t index);
+void table_delete_row(Table *table, size_t index);
 
 // Cell insertion
 void add_empty_cell(Table *table);
 void add_cell(Table *table, const char *text);
 void add_cells(Table *table, size_t num_cells, ...);
 void add_cell_gc(Table *table, char *text);
+void add_cell_plain(Table *table, const char *text, size_t length);
 void add_cell_fmt(Table *table, const char *fmt, ...);
 void add_cell_vfmt(Table *table, const char *fmt, va_list args);
 void add_cells_from_array(Table *table, size_t width, size_t height, const char **array);
+void add_cell_table(Table *table, Table *subtable);
+bool add_cells_from_csv(Table *table, const char *path, char delimiter);
+
+// Concurrent row insertion
+TableRowBuilder *get_row_builder(Table *table);
+void row_builder_add_empty_cell(TableRowBuilder *builder);
+void row_builder_add_cell(TableRowBuilder *builder, const char *text);
+void row_builder_add_cell_gc(TableRowBuilder *builder, char *text);
+void row_builder_add_cell_fmt(TableRowBuilder *builder, const char *fmt, ...);
+void publish_row(TableRowBuilder *builder);
+void publish_row_ordered(TableRowBuilder *builder, uint64_t key);
 
 // Settings
 void set_default_alignments(Table *table, size_t num_alignments, const TableHAlign *hor_aligns, const TableVAlign *vert_aligns);
@@ -54,6 +268,13 @@ void override_vertical_alignment(Table *table, TableVAlign align);
 void override_horizontal_alignment(Table *table, TableHAlign align);
 void override_vertical_alignment_of_row(Table *table, TableVAlign align);
 void override_horizontal_alignment_of_row(Table *table, TableHAlign align);
+void set_default_style(Table *table, size_t col, TableStyle style);
+void set_max_width(Table *table, size_t col, size_t max_width, TableOverflow overflow);
+void set_max_lines(Table *table, size_t col, size_t max_lines);
+void set_fixed_width(Table *table, size_t col, size_t width);
+void override_style(Table *table, TableStyle style);
+void add_style_rule(Table *table, size_t col, const TableStyleRule *rule);
+void override_style_of_row(Table *table, TableStyle style);
 void set_hline(Table *table, TableBorderStyle style);
 void set_vline(Table *table, size_t index, TableBorderStyle style);
 void make_boxed(Table *table, TableBorderStyle style);
@@ -61,3 +282,5 @@ void set_all_vlines(Table *table, TableBorderStyle style);
 void override_left_border(Table *table, TableBorderStyle style);
 void override_above_border(Table *table, TableBorderStyle style);
 void set_span(Table *table, size_t span_x, size_t span_y);
+void set_border_glyphs(Table *table, TableGlyphSet glyph_set);
+void set_custom_border_glyphs(Table *table, const TableBorderGlyphs *glyphs);
@@ -0,0 +1,221 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Asynchronous rendering: Submitted tables are rendered by a worker thread into the back one of two buffers.
+ * The caller takes finished output from the front buffer whenever convenient, so neither waits for the other.
+ */
+
+struct RenderBuffer
+{
+    char *data;
+    size_t capacity;
+    size_t length; // Bytes of last rendering
+};
+
+struct TableRenderer
+{
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;          // Signaled when a table is pending, the back buffer is free or on stop
+    Table *pending;                 // Submitted table that is rendered next, NULL if none
+    struct RenderBuffer buffers[2]; // Front buffer is read by the caller, back buffer is written by worker
+    size_t front;                   // Index of front buffer
+    bool is_ready;                  // Back buffer holds output that was not taken yet
+    bool is_stopped;
+    int event_fd;                   // Readable iff is_ready
+    TableRenderCallback callback;
+    void *context;
+    Allocator allocator;            // Used for the renderer and its buffers, not for submitted tables
+};
+
+/*
+Summary: Renders again when output does not fit, which is rare since sizes of a status table hardly change.
+    If the buffer can not grow, it is kept and the output is empty.
+*/
+static void render_into_buffer(const Allocator *allocator, Table *table, struct RenderBuffer *buffer)
+{
+    size_t length = table_render_into(table, buffer->data, buffer->capacity);
+    if (length > buffer->capacity)
+    {
+        // First growth passes NULL, which allocates like realloc does
+        char *data = buffer->data != NULL ? allocator->realloc(allocator->context, buffer->data, length)
+            : allocator->alloc(allocator->context, length);
+        if (data == NULL)
+        {
+            buffer->length = 0;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = length;
+        table_render_into(table, buffer->data, buffer->capacity);
+    }
+    buffer->length = length;
+}
+
+static void *run_worker(void *arg)
+{
+    TableRenderer *renderer = arg;
+    pthread_mutex_lock(&renderer->lock);
+    while (true)
+    {
+        while (!renderer->is_stopped && (renderer->pending == NULL || renderer->is_ready))
+        {
+            pthread_cond_wait(&renderer->wakeup, &renderer->lock);
+        }
+        if (renderer->is_stopped) break;
+
+        // Back buffer is not touched by the caller until is_ready is set
+        Table *table = renderer->pending;
+        renderer->pending = NULL;
+        struct RenderBuffer *back = &renderer->buffers[1 - renderer->front];
+        pthread_mutex_unlock(&renderer->lock);
+        render_into_buffer(&renderer->allocator, table, back);
+        free_table(table);
+
+        pthread_mutex_lock(&renderer->lock);
+        renderer->is_ready = true;
+        uint64_t one = 1;
+        ssize_t written = write(renderer->event_fd, &one, sizeof(one));
+        (void)written;
+        pthread_mutex_unlock(&renderer->lock);
+
+        if (renderer->callback != NULL) renderer->callback(renderer, renderer->context);
+        pthread_mutex_lock(&renderer->lock);
+    }
+    pthread_mutex_unlock(&renderer->lock);
+    return NULL;
+}
+
+/*
+Summary: Starts a worker thread that renders submitted tables in the background.
+    callback (may be NULL) is called on the worker thread whenever output is ready to be taken.
+Returns: NULL if the thread or its event fd could not be created
+*/
+TableRenderer *get_table_renderer(TableRenderCallback callback, void *context)
+{
+    return get_table_renderer_with_allocator(callback, context, &DEFAULT_ALLOCATOR);
+}
+
+/*
+Summary: Like get_table_renderer, but the renderer and its output buffers are obtained from allocator,
+    which has to be usable from the worker thread.
+*/
+TableRenderer *get_table_renderer_with_allocator(TableRenderCallback callback, void *context, const Allocator *allocator)
+{
+    assert(allocator != NULL);
+    TableRenderer *renderer = allocator->alloc(allocator->context, sizeof(TableRenderer));
+    if (renderer == NULL) return NULL;
+    *renderer = (TableRenderer){
+        .pending    = NULL,
+        .buffers    = { { NULL, 0, 0 }, { NULL, 0, 0 } },
+        .front      = 0,
+        .is_ready   = false,
+        .is_stopped = false,
+        .callback   = callback,
+        .context    = context,
+        .allocator  = *allocator
+    };
+    renderer->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (renderer->event_fd < 0)
+    {
+        allocator->free(allocator->context, renderer);
+        return NULL;
+    }
+    pthread_mutex_init(&renderer->lock, NULL);
+    pthread_cond_init(&renderer->wakeup, NULL);
+    if (pthread_create(&renderer->worker, NULL, run_worker, renderer) != 0)
+    {
+        pthread_cond_destroy(&renderer->wakeup);
+        pthread_mutex_destroy(&renderer->lock);
+        close(renderer->event_fd);
+        allocator->free(allocator->context, renderer);
+        return NULL;
+    }
+    return renderer;
+}
+
+/*
+Summary: Hands table over to be rendered in the background and freed afterwards, don't use it any more.
+    A table that was submitted before and is still waiting is freed without being rendered.
+    The allocator of table needs to be usable from the worker thread.
+*/
+void table_renderer_submit(TableRenderer *renderer, Table *table)
+{
+    assert(renderer != NULL);
+    assert(table != NULL);
+    pthread_mutex_lock(&renderer->lock);
+    Table *replaced = renderer->pending;
+    renderer->pending = table;
+    pthread_cond_signal(&renderer->wakeup);
+    pthread_mutex_unlock(&renderer->lock);
+    if (replaced != NULL) free_table(replaced);
+}
+
+/*
+Summary: File descriptor that is readable (e.g. for poll) while output is ready to be taken.
+*/
+int table_renderer_fd(const TableRenderer *renderer)
+{
+    assert(renderer != NULL);
+    return renderer->event_fd;
+}
+
+/*
+Summary: Takes the newest finished output, which stays valid until the next call. Never blocks.
+Returns: False if no new output is ready, then the previously taken output is returned again (empty at first).
+*/
+bool table_renderer_take(TableRenderer *renderer, const char **out_output, size_t *out_length)
+{
+    assert(renderer != NULL);
+    assert(out_output != NULL);
+    assert(out_length != NULL);
+    pthread_mutex_lock(&renderer->lock);
+    bool is_ready = renderer->is_ready;
+    if (is_ready)
+    {
+        renderer->front = 1 - renderer->front;
+        renderer->is_ready = false;
+        uint64_t count;
+        ssize_t read_bytes = read(renderer->event_fd, &count, sizeof(count));
+        (void)read_bytes;
+        pthread_cond_signal(&renderer->wakeup);
+    }
+    const struct RenderBuffer *front = &renderer->buffers[renderer->front];
+    pthread_mutex_unlock(&renderer->lock);
+
+    *out_output = front->data;
+    *out_length = front->length;
+    return is_ready;
+}
+
+/*
+Summary: Stops the worker, waiting for a rendering in progress. Pending tables are freed, taken output becomes invalid.
+*/
+void free_table_renderer(TableRenderer *renderer)
+{
+    assert(renderer != NULL);
+    pthread_mutex_lock(&renderer->lock);
+    renderer->is_stopped = true;
+    pthread_cond_signal(&renderer->wakeup);
+    pthread_mutex_unlock(&renderer->lock);
+    pthread_join(renderer->worker, NULL);
+
+    if (renderer->pending != NULL) free_table(renderer->pending);
+    // Renderer contains its allocator
+    Allocator allocator = renderer->allocator;
+    for (size_t i = 0; i < 2; i++)
+    {
+        if (renderer->buffers[i].data != NULL) allocator.free(allocator.context, renderer->buffers[i].data);
+    }
+    close(renderer->event_fd);
+    pthread_cond_destroy(&renderer->wakeup);
+    pthread_mutex_destroy(&renderer->lock);
+    allocator.free(allocator.context, renderer);
+}
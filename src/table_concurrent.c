@@ -0,0 +1,170 @@
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Concurrent publishing of rows: Each producer fills a row privately with a TableRowBuilder
+ * and links it into the list of rows of the table without locks.
+ * The cursor-based functions (add_cell, next_row, ...) must not be used while producers publish.
+ */
+
+enum PublishMode
+{
+    PUBLISH_NONE,
+    PUBLISH_ARRIVAL, // Rows are appended in order of publishing
+    PUBLISH_ORDERED  // Rows are inserted in order of keys
+};
+
+struct TableRowBuilder
+{
+    Table *table;
+    struct Row *row; // Not yet visible to anyone else
+    size_t curr_col; // Col of next inserted cell
+};
+
+static void atomic_max(size_t *var, size_t value)
+{
+    size_t curr = __atomic_load_n(var, __ATOMIC_RELAXED);
+    while (curr < value
+        && !__atomic_compare_exchange_n(var, &curr, value, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// A table can not mix both ways of publishing, since ordered insertions do not maintain last_row
+static void claim_publish_mode(Table *table, enum PublishMode mode)
+{
+    int expected = PUBLISH_NONE;
+    __atomic_compare_exchange_n(&table->publish_mode, &expected, mode, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    assert(expected == PUBLISH_NONE || expected == (int)mode);
+}
+
+static void add_builder_text(TableRowBuilder *builder, char *text, size_t length, bool needs_free)
+{
+    assert(builder != NULL);
+    assert(builder->curr_col < TABLE_MAX_COLS);
+    set_cell_text(&builder->row->cells[builder->curr_col], text, length, needs_free);
+    builder->curr_col++;
+}
+
+// Makes columns of row known to table before row becomes visible
+static void prepare_publishing(TableRowBuilder *builder)
+{
+    Table *table = builder->table;
+    // Evicting rows would race with printing them
+    assert(table->row_capacity == 0);
+    atomic_max(&table->num_cols, builder->curr_col);
+    atomic_max(&table->num_content_cols, builder->curr_col);
+    for (size_t i = 0; i < builder->curr_col; i++)
+    {
+        STATS_ADD_ATOMIC(table, num_cells, 1);
+        STATS_ADD_ATOMIC(table, num_multiline_cells, builder->row->cells[i].text_height > 1);
+        __atomic_fetch_add(&table->num_multiline_cells, builder->row->cells[i].text_height > 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&table->version, 1, __ATOMIC_RELAXED);
+}
+
+/*
+Summary: Returns a builder for a single row of table that can be filled by one thread without synchronization.
+    The allocator of table needs to be thread-safe when builders are used concurrently.
+*/
+TableRowBuilder *get_row_builder(Table *table)
+{
+    assert(table != NULL);
+    TableRowBuilder *res = table_alloc(table, sizeof(TableRowBuilder));
+    *res = (TableRowBuilder){
+        .table    = table,
+        .row      = malloc_row(table),
+        .curr_col = 0
+    };
+    return res;
+}
+
+void row_builder_add_empty_cell(TableRowBuilder *builder)
+{
+    add_builder_text(builder, NULL, 0, false);
+}
+
+// Buffer is not copied, see add_cell
+void row_builder_add_cell(TableRowBuilder *builder, const char *text)
+{
+    add_builder_text(builder, (char*)text, text != NULL ? strlen(text) : 0, false);
+}
+
+// Buffer is freed with table, see add_cell_gc
+void row_builder_add_cell_gc(TableRowBuilder *builder, char *text)
+{
+    add_builder_text(builder, text, text != NULL ? strlen(text) : 0, true);
+}
+
+void row_builder_add_cell_fmt(TableRowBuilder *builder, const char *fmt, ...)
+{
+    assert(builder != NULL);
+    va_list args;
+    va_start(args, fmt);
+    size_t length;
+    char *text = format_text(builder->table, fmt, args, &length);
+    va_end(args);
+    add_builder_text(builder, text, length, true);
+}
+
+/*
+Summary: Appends row of builder to its table without locking, rows appear in order of publishing.
+    Can be called concurrently by any number of threads. Builder is consumed.
+*/
+void publish_row(TableRowBuilder *builder)
+{
+    assert(builder != NULL);
+    Table *table = builder->table;
+    struct Row *row = builder->row;
+    claim_publish_mode(table, PUBLISH_ARRIVAL);
+    prepare_publishing(builder);
+
+    // Claim position at end first, then link predecessor to it
+    // Until then, renderers see the list ending before this row
+    struct Row *prev = __atomic_exchange_n(&table->last_row, row, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next_row, row, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&table->num_rows, 1, __ATOMIC_RELAXED);
+    table_free(table, builder);
+}
+
+/*
+Summary: Inserts row of builder without locking before the first ordered row with a greater key, i.e. ordered rows
+    are sorted by key regardless of when they were published. Can be called concurrently by any number of threads.
+    Builder is consumed.
+*/
+void publish_row_ordered(TableRowBuilder *builder, uint64_t key)
+{
+    assert(builder != NULL);
+    Table *table = builder->table;
+    struct Row *row = builder->row;
+    claim_publish_mode(table, PUBLISH_ORDERED);
+    prepare_publishing(builder);
+    row->has_key = true;
+    row->key = key;
+
+    // Rows never move, so search can start at latest ordered row when its key is not greater
+    struct Row *pred = __atomic_load_n(&table->last_row, __ATOMIC_ACQUIRE);
+    if (!pred->has_key || pred->key > key) pred = table->first_row;
+
+    while (true)
+    {
+        struct Row *next = get_next_row(pred);
+        if (next != NULL && (!next->has_key || next->key <= key))
+        {
+            pred = next;
+            continue;
+        }
+
+        row->next_row = next;
+        if (__atomic_compare_exchange_n(&pred->next_row, &next, row, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+        // Another row was inserted after pred in the meantime, continue search from pred
+    }
+
+    __atomic_store_n(&table->last_row, row, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&table->num_rows, 1, __ATOMIC_RELAXED);
+    table_free(table, builder);
+}
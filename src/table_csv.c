@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "table_internal.h"
+
+// Broadcasts a byte to all 8 bytes of a word
+#define REPEAT_BYTE(b) ((uint64_t)(unsigned char)(b) * 0x0101010101010101ULL)
+
+// Nonzero iff any byte of word is zero
+static uint64_t has_zero_byte(uint64_t word)
+{
+    return (word - REPEAT_BYTE(0x01)) & ~word & REPEAT_BYTE(0x80);
+}
+
+/*
+Summary: Finds end of an unquoted field, i.e. next delimiter or newline.
+    Examines 8 bytes per step and only falls back to single bytes in the word that contains the match.
+Returns: Pointer to delimiter, newline or end
+*/
+static const char *find_field_end(const char *pos, const char *end, char delimiter)
+{
+    uint64_t delimiters = REPEAT_BYTE(delimiter);
+    uint64_t newlines = REPEAT_BYTE('\n');
+
+    while (end - pos >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, pos, sizeof(word));
+        if (has_zero_byte(word ^ delimiters) | has_zero_byte(word ^ newlines)) break;
+        pos += 8;
+    }
+    while (pos < end && *pos != delimiter && *pos != '\n') pos++;
+    return pos;
+}
+
+/*
+Summary: Parses a quoted field. Its content is only copied when it contains escaped quotes ("").
+    pos must point to the opening quote.
+Returns: Pointer behind closing quote
+*/
+static const char *parse_quoted_field(Table *table, const char *pos, const char *end,
+    char **out_text, size_t *out_length, bool *out_needs_free)
+{
+    const char *start = pos + 1;
+    const char *closing = memchr(start, '"', end - start);
+    bool has_escapes = false;
+    while (closing != NULL && closing + 1 < end && closing[1] == '"')
+    {
+        has_escapes = true;
+        closing = memchr(closing + 2, '"', end - closing - 2);
+    }
+    // Unterminated quote: Field extends to end of file
+    if (closing == NULL) closing = end;
+
+    if (!has_escapes)
+    {
+        *out_text = (char*)start;
+        *out_length = closing - start;
+        *out_needs_free = false;
+    }
+    else
+    {
+        char *copy = table_alloc(table, closing - start);
+        size_t length = 0;
+        for (const char *curr = start; curr < closing; curr++)
+        {
+            copy[length++] = *curr;
+            if (*curr == '"') curr++; // Skip second quote of ""
+        }
+        *out_text = copy;
+        *out_length = length;
+        *out_needs_free = true;
+    }
+
+    return closing < end ? closing + 1 : end;
+}
+
+/*
+Summary: Inserts cells from a CSV file (or TSV when delimiter is '\t') beginning at current position, one row per record.
+    The file is memory-mapped and unmapped on free_table. Cells point into the mapping, only fields with
+    escaped quotes are copied. Fields beyond TABLE_MAX_COLS are ignored.
+Returns: False when file could not be opened or mapped
+*/
+bool add_cells_from_csv(Table *table, const char *path, char delimiter)
+{
+    assert(table != NULL);
+    assert(path != NULL);
+    assert(delimiter != '"' && delimiter != '\n');
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    size_t length = info.st_size;
+    if (length == 0)
+    {
+        close(fd);
+        return true;
+    }
+    char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+    VEC_PUSH_ELEM(&table->mappings, struct Mapping, ((struct Mapping){ .address = data, .length = length }));
+
+    const char *pos = data;
+    const char *end = data + length;
+    while (pos < end)
+    {
+        // Parse fields of a single record
+        while (true)
+        {
+            char *text;
+            size_t text_length;
+            bool needs_free = false;
+
+            if (pos < end && *pos == '"')
+            {
+                pos = parse_quoted_field(table, pos, end, &text, &text_length, &needs_free);
+                // Ignore anything between closing quote and next delimiter
+                pos = find_field_end(pos, end, delimiter);
+            }
+            else
+            {
+                const char *field_end = find_field_end(pos, end, delimiter);
+                text = (char*)pos;
+                text_length = field_end - pos;
+                // Tolerate CRLF line endings
+                if (text_length > 0 && field_end < end && text[text_length - 1] == '\r') text_length--;
+                pos = field_end;
+            }
+
+            if (table->curr_col < TABLE_MAX_COLS)
+            {
+                add_text_cell(table, text, text_length, needs_free);
+            }
+            else if (needs_free)
+            {
+                table_free(table, text);
+            }
+
+            if (pos < end && *pos == delimiter)
+            {
+                pos++;
+                continue;
+            }
+            break;
+        }
+
+        // Skip newline
+        if (pos < end) pos++;
+        next_row(table);
+    }
+
+    return true;
+}
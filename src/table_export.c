@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "string_util.h"
+#include "table_internal.h"
+
+/*
+ * Serializers for machines: No layout is computed and no padding is emitted.
+ * Every format is written in a single pass over the rows.
+ */
+
+// How to escape a byte in a given format, NULL when it is written as it is
+static const char *CSV_ESCAPES[256]      = { ['"'] = "\"\"" };
+static const char *TSV_ESCAPES[256]      = { ['\t'] = "\\t", ['\n'] = "\\n", ['\r'] = "\\r", ['\\'] = "\\\\" };
+static const char *MARKDOWN_ESCAPES[256] = { ['|'] = "\\|", ['\n'] = "<br>", ['\r'] = "" };
+static const char *JSON_ESCAPES[256]     = { ['"'] = "\\\"", ['\\'] = "\\\\", ['\n'] = "\\n", ['\r'] = "\\r",
+                                             ['\t'] = "\\t", ['\b'] = "\\b", ['\f'] = "\\f" };
+
+// Spanned-over cells contain the text of the cell that spans over them, spans has to be at row
+static const struct Cell *resolve_span(const struct SpanSweep *spans, const struct Row *row, size_t col)
+{
+    const struct Cell *parent = get_spanning_cell(spans, row, col);
+    return parent != NULL ? parent : &row->cells[col];
+}
+
+/*
+Summary: Shrinks a line to its displayed content without surrounding spaces, which are commonly used as padding in cells.
+    Color codes at the borders of the line are dropped with the spaces.
+*/
+static void trim_line(const char *line, const char *end, const char **out_start, const char **out_end)
+{
+    *out_start = end;
+    *out_end = end;
+
+    while (line < end)
+    {
+        if (*line == '\033')
+        {
+            line = skip_ansi_bounded(line, end);
+            continue;
+        }
+        if (*line != ' ')
+        {
+            if (*out_start == end) *out_start = line;
+            *out_end = line + 1;
+        }
+        line++;
+    }
+}
+
+// Writes text in runs of bytes that need no escaping. ANSI color sequences are stripped.
+static void write_escaped(struct Output *out, const char *text, const char *end,
+    const char **escapes, bool escape_controls)
+{
+    const char *run = text;
+    const char *curr = text;
+    while (curr < end)
+    {
+        unsigned char c = *curr;
+        if (c == '\033')
+        {
+            out_write(out, run, curr - run);
+            curr = skip_ansi_bounded(curr, end);
+            run = curr;
+        }
+        else if (escapes[c] != NULL)
+        {
+            out_write(out, run, curr - run);
+            out_string(out, escapes[c]);
+            run = ++curr;
+        }
+        else if (escape_controls && c < 0x20)
+        {
+            char code[7];
+            out_write(out, run, curr - run);
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            out_write(out, code, 6);
+            run = ++curr;
+        }
+        else
+        {
+            curr++;
+        }
+    }
+    out_write(out, run, curr - run);
+}
+
+static bool csv_needs_quotes(const char *text, const char *end)
+{
+    for (; text < end; text++)
+    {
+        if (*text == ',' || *text == '"' || *text == '\n' || *text == '\r') return true;
+    }
+    return false;
+}
+
+// Writes trimmed lines of text, newlines in between are escaped like any other char
+static void write_lines(struct Output *out, const char *text, const char *end,
+    const char **escapes, bool escape_controls)
+{
+    while (true)
+    {
+        const char *newline = memchr(text, '\n', end - text);
+        const char *start;
+        const char *stop;
+        trim_line(text, newline != NULL ? newline : end, &start, &stop);
+        write_escaped(out, start, stop, escapes, escape_controls);
+        if (newline == NULL) break;
+        write_escaped(out, newline, newline + 1, escapes, escape_controls);
+        text = newline + 1;
+    }
+}
+
+static void write_field(struct Output *out, const struct Cell *cell, TableFormat format)
+{
+    if (!cell->is_set || cell->text == NULL)
+    {
+        if (format == TABLE_FORMAT_NDJSON) out_write(out, "\"\"", 2);
+        return;
+    }
+
+    const char *start = cell->text;
+    const char *end = cell->text + cell->text_length;
+
+    switch (format)
+    {
+        case TABLE_FORMAT_CSV:
+            if (csv_needs_quotes(start, end))
+            {
+                out_write(out, "\"", 1);
+                write_lines(out, start, end, CSV_ESCAPES, false);
+                out_write(out, "\"", 1);
+            }
+            else
+            {
+                write_lines(out, start, end, CSV_ESCAPES, false);
+            }
+            break;
+        case TABLE_FORMAT_TSV:
+            write_lines(out, start, end, TSV_ESCAPES, false);
+            break;
+        case TABLE_FORMAT_MARKDOWN:
+            write_lines(out, start, end, MARKDOWN_ESCAPES, false);
+            break;
+        case TABLE_FORMAT_NDJSON:
+            out_write(out, "\"", 1);
+            write_lines(out, start, end, JSON_ESCAPES, true);
+            out_write(out, "\"", 1);
+            break;
+    }
+}
+
+// Rows without any set or spanned-over cell occupy no lines when printed and are not exported
+static bool is_empty_row(const Table *table, const struct SpanSweep *spans, const struct Row *row)
+{
+    for (size_t i = 0; i < table->num_content_cols; i++)
+    {
+        if (row->cells[i].is_set || spans->covering[i] != NULL) return false;
+    }
+    return true;
+}
+
+// Visits non-empty rows in order, rows of the spill file follow the first row
+struct RowWalk
+{
+    const Table *table;
+    struct SpillReader *spilled; // NULL if no row is spilled
+    size_t index;                // Index of row
+    const struct Row *row;       // NULL after last row, a spilled row stays valid until the next but one is visited
+    struct SpanSweep spans;      // At row
+};
+
+static void step_row(struct RowWalk *walk)
+{
+    walk->index++;
+    walk->row = get_following_row(walk->table, walk->spilled, walk->index, walk->row);
+}
+
+// Moves spans along to the next non-empty row at or after row
+static void skip_empty_rows(struct RowWalk *walk)
+{
+    for (; walk->row != NULL; step_row(walk))
+    {
+        advance_spans(&walk->spans, walk->row);
+        if (!is_empty_row(walk->table, &walk->spans, walk->row)) break;
+    }
+}
+
+static void begin_walk(struct RowWalk *walk, Table *table)
+{
+    walk->table = table;
+    walk->spilled = open_spill_reader(table);
+    walk->index = 0;
+    walk->row = table->first_row;
+    init_spans(&walk->spans);
+    skip_empty_rows(walk);
+}
+
+static void next_nonempty_row(struct RowWalk *walk)
+{
+    step_row(walk);
+    skip_empty_rows(walk);
+}
+
+static void write_separated_row(struct Output *out, const Table *table, const struct SpanSweep *spans,
+    const struct Row *row, TableFormat format, const char *separator)
+{
+    for (size_t i = 0; i < table->num_content_cols; i++)
+    {
+        if (i != 0) out_string(out, separator);
+        write_field(out, resolve_span(spans, row, i), format);
+    }
+    out_write(out, "\n", 1);
+}
+
+static void write_markdown_row(struct Output *out, const Table *table, const struct SpanSweep *spans,
+    const struct Row *row)
+{
+    out_write(out, "| ", 2);
+    for (size_t i = 0; i < table->num_content_cols; i++)
+    {
+        if (i != 0) out_write(out, " | ", 3);
+        write_field(out, resolve_span(spans, row, i), TABLE_FORMAT_MARKDOWN);
+    }
+    out_write(out, " |\n", 3);
+}
+
+// Alignment row of markdown table is derived from default alignment of columns
+static void write_markdown_delimiter_row(struct Output *out, const Table *table)
+{
+    out_write(out, "|", 1);
+    for (size_t i = 0; i < table->num_content_cols; i++)
+    {
+        switch (table->h_aligns[i])
+        {
+            case H_ALIGN_LEFT:
+                out_write(out, " --- |", 6);
+                break;
+            case H_ALIGN_RIGHT:
+                out_write(out, " --: |", 6);
+                break;
+            case H_ALIGN_CENTER:
+                out_write(out, " :-: |", 6);
+        }
+    }
+    out_write(out, "\n", 1);
+}
+
+// Writes '"key":' of every column, columns with empty header get their index as key
+static void write_json_keys(struct Output *out, const Table *table, const struct SpanSweep *spans,
+    const struct Row *header, size_t *out_offsets)
+{
+    for (size_t i = 0; i < table->num_content_cols; i++)
+    {
+        out_offsets[i] = out->written;
+        const struct Cell *cell = resolve_span(spans, header, i);
+        const char *start = NULL;
+        const char *end = NULL;
+        if (cell->is_set && cell->text != NULL) trim_line(cell->text, cell->text + cell->text_length, &start, &end);
+
+        if (start != end)
+        {
+            write_field(out, cell, TABLE_FORMAT_NDJSON);
+        }
+        else
+        {
+            char key[32];
+            out_write(out, key, snprintf(key, sizeof(key), "\"%zu\"", i));
+        }
+        out_write(out, ":", 1);
+    }
+    out_offsets[table->num_content_cols] = out->written;
+}
+
+/*
+Summary: Keys are escaped once into a buffer instead of once per row
+Returns: Buffer, out_offsets[i] to out_offsets[i + 1] is the key of column i
+*/
+static char *prepare_json_keys(const Table *table, const struct SpanSweep *spans, const struct Row *header,
+    size_t *out_offsets)
+{
+    struct Output counter = output_counting();
+    write_json_keys(&counter, table, spans, header, out_offsets);
+    char *buffer = table_alloc(table, counter.written);
+    struct Output out = output_from_buffer(buffer, counter.written);
+    write_json_keys(&out, table, spans, header, out_offsets);
+    return buffer;
+}
+
+static void write_ndjson(struct Output *out, const Table *table, struct RowWalk *walk)
+{
+    if (walk->row == NULL) return;
+    size_t offsets[TABLE_MAX_COLS + 1];
+    char *keys = prepare_json_keys(table, &walk->spans, walk->row, offsets);
+
+    for (next_nonempty_row(walk); walk->row != NULL; next_nonempty_row(walk))
+    {
+        out_write(out, "{", 1);
+        for (size_t i = 0; i < table->num_content_cols; i++)
+        {
+            if (i != 0) out_write(out, ",", 1);
+            out_write(out, keys + offsets[i], offsets[i + 1] - offsets[i]);
+            write_field(out, resolve_span(&walk->spans, walk->row, i), TABLE_FORMAT_NDJSON);
+        }
+        out_write(out, "}\n", 2);
+    }
+
+    table_free(table, keys);
+}
+
+static void write_table(struct Output *out, Table *table, TableFormat format)
+{
+    struct RowWalk walk;
+    begin_walk(&walk, table);
+    switch (format)
+    {
+        case TABLE_FORMAT_CSV:
+        case TABLE_FORMAT_TSV:
+        {
+            const char *separator = format == TABLE_FORMAT_CSV ? "," : "\t";
+            for (; walk.row != NULL; next_nonempty_row(&walk))
+            {
+                write_separated_row(out, table, &walk.spans, walk.row, format, separator);
+            }
+            break;
+        }
+        case TABLE_FORMAT_MARKDOWN:
+        {
+            if (walk.row == NULL) break;
+            write_markdown_row(out, table, &walk.spans, walk.row);
+            write_markdown_delimiter_row(out, table);
+            for (next_nonempty_row(&walk); walk.row != NULL; next_nonempty_row(&walk))
+            {
+                write_markdown_row(out, table, &walk.spans, walk.row);
+            }
+            break;
+        }
+        case TABLE_FORMAT_NDJSON:
+            write_ndjson(out, table, &walk);
+    }
+    close_spill_reader(walk.spilled);
+}
+
+/*
+Summary: Writes table in a machine-readable format without computing a layout.
+    Color codes and surrounding spaces of each line are stripped, borders are ignored.
+    Cells that are spanned over repeat the text of the spanning cell, rows without any set cell are omitted.
+    The first non-empty row is used as header for TABLE_FORMAT_MARKDOWN and as keys for TABLE_FORMAT_NDJSON.
+*/
+void fprint_table_as(Table *table, FILE *stream, TableFormat format)
+{
+    assert(table != NULL);
+    assert(stream != NULL);
+    TableSink sink = get_stream_sink(stream);
+    struct SinkBuffer buffer;
+    struct Output out = output_from_sink(&buffer, &sink);
+    write_table(&out, table, format);
+    finish_sink(&buffer);
+}
@@ -0,0 +1,79 @@
+#include <string.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Glyph sets are copied into the table, so the renderer looks glyphs up without going through strlen.
+ * Single-byte glyphs of ASCII borders make lines of borders plain memset runs.
+ */
+
+static const TableBorderGlyphs GLYPH_SETS[] = {
+    [GLYPHS_BOX] = {
+        { "┌", "┬", "┐", "├", "┼", "┤", "└", "┴", "┘", "─", "│" },
+        { "╔", "╦", "╗", "╠", "╬", "╣", "╚", "╩", "╝", "═", "║" }
+    },
+    [GLYPHS_ASCII] = {
+        { "+", "+", "+", "+", "+", "+", "+", "+", "+", "-", "|" },
+        { "+", "+", "+", "+", "+", "+", "+", "+", "+", "=", "|" }
+    },
+    [GLYPHS_ROUNDED] = {
+        { "╭", "┬", "╮", "├", "┼", "┤", "╰", "┴", "╯", "─", "│" },
+        { "╔", "╦", "╗", "╠", "╬", "╣", "╚", "╩", "╝", "═", "║" }
+    },
+    [GLYPHS_HEAVY] = {
+        { "┏", "┳", "┓", "┣", "╋", "┫", "┗", "┻", "┛", "━", "┃" },
+        { "╔", "╦", "╗", "╠", "╬", "╣", "╚", "╩", "╝", "═", "║" }
+    }
+};
+
+static void copy_glyphs(struct Glyph *glyphs, const char *const *source)
+{
+    for (size_t i = 0; i < NUM_GLYPHS - 1; i++)
+    {
+        assert(source[i] != NULL);
+        size_t length = strlen(source[i]);
+        assert(length > 0 && length <= sizeof(glyphs[i].bytes));
+        memcpy(glyphs[i].bytes, source[i], length);
+        glyphs[i].length = length;
+    }
+    glyphs[NUM_GLYPHS - 1] = (struct Glyph){ " ", 1 };
+}
+
+/*
+Summary: Cut lines end with "…", unless all glyphs take a single byte. Then "..." keeps the output ASCII.
+*/
+void update_ellipsis(struct Glyphs *glyphs)
+{
+    bool is_ascii = true;
+    for (size_t i = 0; i < NUM_GLYPHS; i++)
+    {
+        if (glyphs->single_border[i].length > 1 || glyphs->double_border[i].length > 1) is_ascii = false;
+    }
+    glyphs->ellipsis = is_ascii ? (struct Glyph){ "...", 3 } : (struct Glyph){ "…", 3 };
+    glyphs->ellipsis_width = is_ascii ? 3 : 1;
+}
+
+/*
+Summary: Selects the characters borders are drawn with. GLYPHS_ASCII uses single bytes only,
+    which makes output of bordered tables about a third as large. Cut lines end with "..." then.
+*/
+void set_border_glyphs(Table *table, TableGlyphSet glyph_set)
+{
+    assert(table != NULL);
+    assert(glyph_set <= GLYPHS_HEAVY);
+    set_custom_border_glyphs(table, &GLYPH_SETS[glyph_set]);
+}
+
+/*
+Summary: Draws borders with the given glyphs, which are copied. Every glyph must be displayed in a single column.
+*/
+void set_custom_border_glyphs(Table *table, const TableBorderGlyphs *glyphs)
+{
+    assert(table != NULL);
+    assert(glyphs != NULL);
+    copy_glyphs(table->glyphs.single_border, glyphs->single_border);
+    copy_glyphs(table->glyphs.double_border, glyphs->double_border);
+    update_ellipsis(&table->glyphs);
+    table->version++;
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "vector.h"
+#include "table.h"
+
+/*
+ * Internal representation of a table, shared by the modules of this library.
+ * Users only see the opaque Table and the functions in table.h.
+ */
+
+struct Cell
+{
+    char *text;         // Actual content to be displayed, not necessarily \0-terminated
+    size_t text_length; // Number of bytes of text
+    size_t text_height; // Number of lines
+    size_t text_width;  // Maximum width of lines
+
+    // Settings
+    TableHAlign h_align;           // Non default, how to place text in col width
+    TableVAlign v_align;           // Non default, how to place text in col width
+    TableBorderStyle border_left;  // Non-default border left
+    TableBorderStyle border_above; // Non-default border above
+    size_t span_x;                 // How many cols to span over
+    size_t span_y;                 // How many rows to span over
+    uint16_t attr;                 // Non-default style, see encode_style
+
+    // Generated
+    bool override_v_align;      // Default set for each col in table
+    bool override_h_align;      // Default set for each col in table
+    bool override_border_left;  // Default set for each col in table
+    bool override_border_above; // Default set in row
+    bool override_attr;         // Default set for each col in table
+    bool has_escapes;           // Whether text contains color codes, otherwise width is number of bytes
+
+    bool is_set;          // Indicates whether data is valid
+    bool text_needs_free; // When set to true, text will be freed on free_table
+    size_t x;             // Column position
+    Table *nested;        // Table printed instead of text, which stays NULL, see table_nested.c
+};
+
+struct Row
+{
+    struct Cell cells[TABLE_MAX_COLS]; // All cells of this row from left to right
+    struct Row *next_row;              // Pointer to next row or NULL if last row
+    TableBorderStyle border_above;     // Default border above (can be overwritten in cell)
+    int border_above_counter;       // Counts cells that override their border_above
+    bool has_key;                      // Whether row was published with publish_row_ordered
+    uint64_t key;                      // Key of ordered row
+};
+
+// Memory-mapped file whose contents are referenced by cells
+struct Mapping
+{
+    void *address;
+    size_t length;
+};
+
+// Glyphs of matrix in table_glyphs.c: 3x3 box, hline, vline and a space for lines that do not meet
+#define NUM_GLYPHS 12
+#define HLINE_GLYPH 9
+#define VLINE_GLYPH 10
+
+struct Glyph
+{
+    char bytes[4];
+    size_t length; // 1 for ASCII glyphs, which are repeated by memset
+};
+
+// Glyphs of BORDER_SINGLE and BORDER_DOUBLE, and the ellipsis that ends cut lines
+struct Glyphs
+{
+    struct Glyph single_border[NUM_GLYPHS];
+    struct Glyph double_border[NUM_GLYPHS];
+    struct Glyph ellipsis;
+    size_t ellipsis_width; // Columns of ellipsis, each byte takes one when it is wider than one
+};
+
+// Line of a cell as it is shown in a column with limits, see table_overflow.c
+struct DisplayLine
+{
+    const char *start;     // Shown bytes of text
+    size_t length;
+    size_t width;          // Columns the shown bytes take
+    bool is_cut;           // Line continues beyond the shown bytes, an ellipsis follows them
+    const char *next;      // Start of next display line, NULL if text ends with this line
+};
+
+/*
+ * Spans are only stored in the cell they begin in (span_x, span_y), covered cells are never touched.
+ * Visiting rows in order, a SpanSweep knows which cells span over the current row.
+ */
+struct SpanSweep
+{
+    const struct Cell *covering[TABLE_MAX_COLS]; // Cell whose span contains col of current row, NULL if none
+    size_t rows_left[TABLE_MAX_COLS];            // Number of following rows covering[col] spans into
+};
+
+/*
+ * Rows spilled to a temporary file once the table holds more memory than its budget, see table_spill.c.
+ * Rows of a loaded snapshot are kept the same way, in the mapping of the snapshot file (see table_snapshot.c).
+ * Spilled rows follow the first row, which always stays in memory. Their layout metrics are kept here.
+ */
+struct SpanSize
+{
+    size_t from_index; // Inclusive, col or row index in render
+    size_t to_index;   // Exclusive
+    size_t size;       // Width not weakened by vlines yet, height weakened by the hlines in between
+};
+
+struct Spill
+{
+    FILE *file;                        // NULL for rows of a snapshot, no rows are spilled then
+    size_t budget;                     // Resident bytes above which rows are spilled
+    size_t num_rows;                   // Number of rows in file
+    size_t file_length;                // Bytes written to file
+    const char *data;                  // Reservation the file is mapped into, NULL if none
+    size_t data_length;                // Bytes of file mapped at data, all of them
+    size_t reserved_length;            // Bytes of address space reserved at data, 0 for a snapshot
+    size_t max_span_y;                 // Most rows a spilled cell spans over
+    size_t col_widths[TABLE_MAX_COLS]; // Widest spilled cell of each col that spans a single col
+    Vector span_widths;                // struct SpanSize of spilled cells spanning several cols, in order
+    Vector span_heights;               // struct SpanSize of spilled cells spanning several rows, in order
+    Vector row_heights;                // size_t height of each spilled row without cells spanning several rows
+    Vector record;                     // Scratch buffer a row is encoded in
+};
+
+struct Constraint
+{
+    size_t from_index; // Inclusive
+    size_t to_index;   // Exclusive
+    size_t min;        // Needed size (i.e. minimum size needed)
+};
+
+struct Table
+{
+    size_t num_cols;                         // Number of columns (max. of num_cells over all rows)
+    size_t num_content_cols;                 // Number of columns that contain set cells (vlines excluded)
+    size_t num_rows;                         // Number of rows (length of linked list)
+    struct Row *first_row;                   // Start of linked list to rows
+    struct Row *last_row;                    // End of linked list, new rows are published after it
+    struct Row *curr_row;                    // Marker of row of next inserted cell
+    size_t curr_col;                         // Marker of col of next inserted cell
+    struct SpanSweep cursor_spans;           // Spans over curr_row
+    TableBorderStyle borders_left[TABLE_MAX_COLS]; // Default left border of cols
+    TableHAlign h_aligns[TABLE_MAX_COLS];          // Default horizontal alignment of cols
+    TableVAlign v_aligns[TABLE_MAX_COLS];          // Default vertical alignment of cols
+    uint16_t attrs[TABLE_MAX_COLS];                // Default style of cols, see encode_style
+    size_t max_widths[TABLE_MAX_COLS];             // Widest a cell of col is shown, 0 if unlimited
+    size_t max_lines[TABLE_MAX_COLS];              // Most lines a cell of col shows, 0 if unlimited
+    size_t fixed_widths[TABLE_MAX_COLS];           // Width of col, cells are not measured for the layout, 0 if none
+    TableOverflow overflows[TABLE_MAX_COLS];       // How cells of col are shown in max_widths
+    int border_left_counters[TABLE_MAX_COLS];   // Counts cells that override their border_left
+    size_t num_spanning_cells;               // Cells that were made to span, tables without them print faster
+    size_t num_multiline_cells;              // Cells inserted with several lines of text
+    size_t num_border_overrides;             // Cells that override a border
+    size_t version;                          // Counts changes, renderings of nested tables are kept while unchanged
+    Vector nested_cells;                     // struct Cell* of cells that print a nested table
+    struct Nesting *nesting;                 // Cached rendering, NULL unless table was nested into another one
+    TableLayout *layout;                     // Widths shared with other tables, NULL if table has its own
+    Vector style_rules;                      // struct StyleRule in order of insertion, see table_rules.c
+    size_t num_style_rules[TABLE_MAX_COLS];  // Rules of each col
+    size_t row_capacity;                     // Most rows kept, older ones are evicted, 0 if unlimited
+    struct WidthHistogram *histograms;       // Widths of set cells per col, NULL unless table has a row capacity
+    size_t num_plans;                        // Plans frozen from table that were not freed yet
+    Vector retired_rows;                     // struct Row* removed while plans referenced them, freed with the last plan
+    Vector mappings;                         // Mappings to unmap on free_table
+    struct Spill *spill;                     // NULL unless a memory budget was set
+    size_t resident_bytes;                   // Memory of rows and owned texts, counted for the budget
+    int publish_mode;                        // How rows are published concurrently, see table_concurrent.c
+    TableCompactMode compact_mode;           // How whitespace is minimized when printing
+    struct Glyphs glyphs;                    // Characters borders are drawn with
+    Allocator allocator;                     // Used for all allocations of this table
+#ifdef TABLE_STATS
+    Allocator user_allocator;                // allocator counts and forwards to it
+    TableStats stats;                        // Counters and timings, see table_get_stats
+#endif
+};
+
+void *table_alloc(const Table *table, size_t size);
+void table_free(const Table *table, void *ptr);
+
+#ifdef TABLE_STATS
+// Instrumentation is only compiled in with -DTABLE_STATS, prints can run concurrently and update fields atomically
+#define STATS_ADD(table, field, amount) ((table)->stats.field += (amount))
+#define STATS_ADD_ATOMIC(table, field, amount) __atomic_fetch_add(&(table)->stats.field, (amount), __ATOMIC_RELAXED)
+#define STATS_SET(table, field, value) __atomic_store_n(&(table)->stats.field, (value), __ATOMIC_RELAXED)
+#define STATS_TIMER_START(timer) uint64_t timer = stats_now()
+#define STATS_TIMER_STOP(table, field, timer) STATS_ADD_ATOMIC(table, field, stats_now() - (timer))
+uint64_t stats_now();
+#else
+#define STATS_ADD(table, field, amount) ((void)(table))
+#define STATS_ADD_ATOMIC(table, field, amount) ((void)(table))
+#define STATS_SET(table, field, value) ((void)(table))
+#define STATS_TIMER_START(timer)
+#define STATS_TIMER_STOP(table, field, timer) ((void)(table))
+#endif
+
+// Destination of rendered bytes, all writes go through out_write
+struct Output
+{
+    void (*write)(struct Output *out, const char *bytes, size_t length);
+    void (*text)(struct Output *out, const char *bytes, size_t length); // Optional, for slices of cell texts
+    void (*spaces)(struct Output *out, size_t count);                    // Optional, for padding
+    void *context;   // FILE* or char* buffer, depending on write
+    size_t capacity; // Size of buffer
+    size_t written;  // Number of bytes emitted so far
+    bool is_terminal; // Whether escape sequences moving the cursor can be used
+};
+
+// State of an output that minimizes whitespace before writing to target
+struct Compactor
+{
+    struct Output *target;
+    TableCompactMode mode;
+    size_t pending; // Spaces not written yet, dropped when line ends
+};
+
+// Collects output into chunks that are handed to sink
+struct SinkBuffer
+{
+    const TableSink *sink;
+    size_t length;                     // Bytes in chunk
+    char chunk[TABLE_SINK_CHUNK_SIZE];
+};
+
+struct Output output_from_sink(struct SinkBuffer *buffer, const TableSink *sink);
+void finish_sink(struct SinkBuffer *buffer);
+struct Output output_from_buffer(char *buffer, size_t capacity);
+struct Output output_counting();
+struct Output output_compacting(struct Compactor *compactor);
+void out_write(struct Output *out, const char *bytes, size_t length);
+void out_string(struct Output *out, const char *string);
+void out_text(struct Output *out, const char *bytes, size_t length);
+void out_spaces(struct Output *out, size_t count);
+
+// Styles are stored as small attribute IDs, 0 is the default style of the terminal
+#define ATTR_DEFAULT 0
+#define ATTR_UNKNOWN 0xFFFF // State of terminal after color codes of a cell text
+uint16_t encode_style(TableStyle style);
+bool is_valid_attr(uint16_t attr);
+struct StyleRule
+{
+    size_t col;
+    TableStyleRule rule;
+    uint16_t attr; // Encoded style of rule
+};
+void apply_style_rules(const Table *table, const struct Cell *cell, uint16_t *out_attr, TableHAlign *out_h_align);
+void out_attr_change(struct Output *out, uint16_t from, uint16_t to);
+
+struct SpillReader; // Reads spilled rows back in order, see table_spill.c
+size_t get_num_spilled(const Table *table);
+struct Spill *create_spill(const Table *table, FILE *file);
+void spill_rows(Table *table);
+void encode_row(Vector *record, const struct Row *row);
+const char *decode_row(const char *record, struct Row *row);
+// Shape of a record, counted into the table that loads it
+struct RecordShape
+{
+    size_t max_span_y;           // Most rows a cell spans over
+    size_t num_spanning_cells;
+    size_t num_multiline_cells;
+    size_t num_border_overrides;
+};
+const char *validate_row(const char *record, const char *end, struct RecordShape *out_shape);
+void add_row_metrics(const Table *table, struct Spill *metrics, const struct Row *row, size_t row_index);
+struct SpillReader *open_spill_reader(Table *table);
+struct Row *read_spilled_row(struct SpillReader *reader, size_t index);
+const struct Row *get_following_row(const Table *table, struct SpillReader *reader, size_t index, const struct Row *prev);
+void close_spill_reader(struct SpillReader *reader);
+void free_spill(const Table *table, struct Spill *spill);
+
+void init_spans(struct SpanSweep *spans);
+void advance_spans(struct SpanSweep *spans, const struct Row *row);
+const struct Cell *get_spanning_cell(const struct SpanSweep *spans, const struct Row *row, size_t col);
+void reset_cursor_spans(Table *table);
+bool has_limits(const Table *table, const struct Cell *cell);
+void get_limited_size(const Table *table, const struct Cell *cell, size_t *out_width, size_t *out_height);
+void get_display_line(const Table *table, const struct Cell *cell, const char *start, struct DisplayLine *out_line);
+size_t take_columns(const char *start, const char *end, size_t columns);
+size_t get_ellipsis_width(const Table *table, size_t columns);
+void update_ellipsis(struct Glyphs *glyphs);
+
+// Inserts a cell at current position, text is a slice of length bytes
+void add_text_cell(Table *table, char *text, size_t length, bool needs_free);
+void set_cell_text(struct Cell *cell, char *text, size_t length, bool needs_free);
+char *format_text(const Table *table, const char *fmt, va_list args, size_t *out_length);
+struct Row *malloc_row(Table *table);
+void init_row(struct Row *row);
+void free_row(Table *table, struct Row *row);
+void get_cell_size(const Table *table, const struct Cell *cell, size_t *out_width, size_t *out_height);
+void fit_fixed_width(Table *table, const struct Cell *cell);
+struct Row *get_next_row(const struct Row *row);
+void render_table(Table *table, struct Output *out);
+void measure_table(Table *table);
+void satisfy_constraints(size_t num_constrs, struct Constraint *constrs, size_t *result);
+void apply_layout(TableLayout *layout, size_t num_constrs, struct Constraint *constrs, size_t num_cols, size_t *out_col_widths);
+size_t get_layout_version(TableLayout *layout);
+size_t render_nested(Table *table, struct Output *target);
+
+struct Nesting; // Rendering of a nested table, see table_nested.c
+void update_nested_cells(Table *table);
+size_t get_nested_line(const Table *nested, size_t line_index, const char **out_start);
+void remove_nested_cell(Table *table, struct Cell *cell);
+void free_nesting(Table *table);
+
+struct WidthHistogram; // Widths of the cells of a col, see table_rows.c
+void add_cell_width(Table *table, const struct Cell *cell);
+void remove_cell_width(Table *table, const struct Cell *cell);
+size_t get_max_cell_width(const Table *table, size_t col);
+void evict_rows(Table *table);
+void retire_row(Table *table, struct Row *row);
+void free_retired_rows(Table *table);
+void free_histograms(Table *table);
+void render_selection(Table *table, struct Row **rows, size_t num_rows,
+    const size_t *cols, size_t num_cols, struct Output *target);
@@ -0,0 +1,90 @@
+#include <pthread.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * A layout holds column widths shared by several tables. Whenever a table using it is measured, its width
+ * constraints are satisfied starting from the shared widths, so widths only grow and tables that were measured
+ * before never need to be measured again. Tables printed after all of them were measured are aligned.
+ */
+
+struct TableLayout
+{
+    pthread_mutex_t lock;               // Tables using layout may be printed by several threads
+    size_t col_widths[TABLE_MAX_COLS];  // Satisfy the width constraints of all tables measured so far
+    size_t version;                     // Counts growths of col_widths, see get_stamp in table_nested.c
+    Allocator allocator;
+};
+
+/*
+Summary: Creates a layout without any widths, tables are added with table_use_layout.
+Returns: NULL if it could not be allocated
+*/
+TableLayout *get_table_layout()
+{
+    return get_table_layout_with_allocator(&DEFAULT_ALLOCATOR);
+}
+
+// Like get_table_layout, but the layout is obtained from allocator
+TableLayout *get_table_layout_with_allocator(const Allocator *allocator)
+{
+    assert(allocator != NULL);
+    TableLayout *layout = allocator->alloc(allocator->context, sizeof(TableLayout));
+    if (layout == NULL) return NULL;
+    *layout = (TableLayout){ .col_widths = { 0 }, .version = 0, .allocator = *allocator };
+    pthread_mutex_init(&layout->lock, NULL);
+    return layout;
+}
+
+/*
+Summary: Prints table with the widths of layout, which are widened by the current cells of table right away.
+    Later changes of table widen them when it is printed. NULL makes table use its own widths again.
+    layout has to outlive the use by table.
+*/
+void table_use_layout(Table *table, TableLayout *layout)
+{
+    assert(table != NULL);
+    table->layout = layout;
+    table->version++;
+    if (layout != NULL) measure_table(table);
+}
+
+/*
+Summary: Widens the cols of layout until constrs are satisfied, then copies the widths of num_cols cols.
+*/
+void apply_layout(TableLayout *layout, size_t num_constrs, struct Constraint *constrs, size_t num_cols, size_t *out_col_widths)
+{
+    pthread_mutex_lock(&layout->lock);
+    size_t prev_widths[TABLE_MAX_COLS];
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++) prev_widths[i] = layout->col_widths[i];
+    satisfy_constraints(num_constrs, constrs, layout->col_widths);
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        if (layout->col_widths[i] != prev_widths[i])
+        {
+            layout->version++;
+            break;
+        }
+    }
+    for (size_t i = 0; i < num_cols; i++) out_col_widths[i] = layout->col_widths[i];
+    pthread_mutex_unlock(&layout->lock);
+}
+
+size_t get_layout_version(TableLayout *layout)
+{
+    pthread_mutex_lock(&layout->lock);
+    size_t version = layout->version;
+    pthread_mutex_unlock(&layout->lock);
+    return version;
+}
+
+// Tables must not use layout any more
+void free_table_layout(TableLayout *layout)
+{
+    assert(layout != NULL);
+    pthread_mutex_destroy(&layout->lock);
+    // Layout contains its allocator
+    Allocator allocator = layout->allocator;
+    allocator.free(allocator.context, layout);
+}
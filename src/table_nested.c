@@ -0,0 +1,159 @@
+#include <assert.h>
+#include <string.h>
+
+#include "table_internal.h"
+
+/*
+ * A table nested into cells of other tables is rendered into a buffer of its own, which every print of these
+ * tables reuses while the nested table stays unchanged. Cells take their size from the layout of the nested table
+ * and copy its lines into the output of their table, they have no text of their own.
+ * The first print after a nested table changed renders it again and resizes its cells, so it must not run
+ * concurrently with other prints of the tables it is nested into. Later prints only read and can run concurrently.
+ */
+
+struct Nesting
+{
+    bool is_rendered;
+    size_t stamp;     // Stamp of table when it was rendered, see get_stamp
+    Vector text;      // char, rendering of table
+    Vector line_ends; // size_t offset of the \n ending each line of text
+    size_t width;     // Columns of every line, renderings are never compacted
+    bool has_escapes; // Whether styles of table change the terminal
+};
+
+/*
+Summary: Versions only grow, so the sum of the versions of a table and the tables nested into it
+    changes whenever one of them changes.
+*/
+static size_t get_stamp(const Table *table)
+{
+    size_t stamp = __atomic_load_n(&table->version, __ATOMIC_RELAXED);
+    if (table->layout != NULL) stamp += get_layout_version(table->layout);
+    for (size_t i = 0; i < vec_count(&table->nested_cells); i++)
+    {
+        const struct Cell *cell = *(struct Cell**)vec_get(&table->nested_cells, i);
+        stamp += get_stamp(cell->nested);
+    }
+    return stamp;
+}
+
+static void write_to_nesting(struct Output *out, const char *bytes, size_t length)
+{
+    struct Nesting *nesting = out->context;
+    size_t offset = vec_count(&nesting->text);
+    vec_push_many(&nesting->text, length, (void*)bytes);
+
+    const char *end = bytes + length;
+    for (const char *newline = memchr(bytes, '\n', length); newline != NULL; newline = memchr(newline + 1, '\n', end - newline - 1))
+    {
+        VEC_PUSH_ELEM(&nesting->line_ends, size_t, offset + (newline - bytes));
+    }
+}
+
+// Renders table again unless its rendering is up to date
+static const struct Nesting *render_nesting(Table *table)
+{
+    struct Nesting *nesting = table->nesting;
+    size_t stamp = get_stamp(table);
+    if (nesting->is_rendered && nesting->stamp == stamp) return nesting;
+
+    vec_clear(&nesting->text);
+    vec_clear(&nesting->line_ends);
+    struct Output out = { .write = write_to_nesting, .context = nesting };
+    nesting->width = render_nested(table, &out);
+    nesting->has_escapes = memchr(nesting->text.buffer, '\033', vec_count(&nesting->text)) != NULL;
+    nesting->stamp = stamp;
+    nesting->is_rendered = true;
+    return nesting;
+}
+
+/*
+Summary: Sizes cells of table that print nested tables by the current layouts of them.
+    Nested tables that changed since they were rendered last are rendered again.
+    Cells are only written when their size changed, so prints of unchanged nested tables do not write.
+*/
+void update_nested_cells(Table *table)
+{
+    for (size_t i = 0; i < vec_count(&table->nested_cells); i++)
+    {
+        struct Cell *cell = *(struct Cell**)vec_get(&table->nested_cells, i);
+        const struct Nesting *nesting = render_nesting(cell->nested);
+        size_t height = vec_count(&nesting->line_ends);
+        if (cell->text_width != nesting->width) cell->text_width = nesting->width;
+        if (cell->text_height != height) cell->text_height = height;
+        if (cell->has_escapes != nesting->has_escapes) cell->has_escapes = nesting->has_escapes;
+    }
+}
+
+/*
+Summary: Finds line line_index of the rendering of nested, as updated by update_nested_cells.
+Returns: Number of bytes of line without \n, out_start is NULL if there is no such line
+*/
+size_t get_nested_line(const Table *nested, size_t line_index, const char **out_start)
+{
+    const struct Nesting *nesting = nested->nesting;
+    *out_start = NULL;
+    if (line_index >= vec_count(&nesting->line_ends)) return 0;
+
+    size_t start = line_index > 0 ? *(size_t*)vec_get(&nesting->line_ends, line_index - 1) + 1 : 0;
+    size_t end = *(size_t*)vec_get(&nesting->line_ends, line_index);
+    *out_start = (const char*)nesting->text.buffer + start;
+    return end - start;
+}
+
+// Turns cell of table into an unset cell that prints no nested table any more
+void remove_nested_cell(Table *table, struct Cell *cell)
+{
+    // Stamps must not repeat, so version makes up for the stamp that is not counted any more
+    table->version += get_stamp(cell->nested) + 1;
+    cell->nested = NULL;
+    for (size_t i = 0; i < vec_count(&table->nested_cells); i++)
+    {
+        struct Cell **entry = vec_get(&table->nested_cells, i);
+        if (*entry == cell)
+        {
+            *entry = *(struct Cell**)vec_pop(&table->nested_cells);
+            break;
+        }
+    }
+}
+
+void free_nesting(Table *table)
+{
+    if (table->nesting == NULL) return;
+    vec_destroy(&table->nesting->text);
+    vec_destroy(&table->nesting->line_ends);
+    table_free(table, table->nesting);
+    table->nesting = NULL;
+}
+
+/*
+Summary: Adds next cell, which prints subtable in place of a text. subtable is not copied and has to outlive
+    the last print of table, later changes of it are shown. A subtable is only rendered again when it changed,
+    however many tables it is nested into. Tables must not be nested into themselves, not even indirectly.
+    The first print after subtable changed must not run concurrently with prints of tables it is nested into.
+*/
+void add_cell_table(Table *table, Table *subtable)
+{
+    assert(table != NULL);
+    assert(subtable != NULL);
+    assert(subtable != table);
+
+    if (subtable->nesting == NULL)
+    {
+        subtable->nesting = table_alloc(subtable, sizeof(struct Nesting));
+        *subtable->nesting = (struct Nesting){
+            .is_rendered = false,
+            .text        = vec_create_with_allocator(sizeof(char), 256, &subtable->allocator),
+            .line_ends   = vec_create_with_allocator(sizeof(size_t), 16, &subtable->allocator)
+        };
+    }
+
+    struct Cell *cell = &table->curr_row->cells[table->curr_col];
+    add_text_cell(table, NULL, 0, false);
+    if (table->histograms != NULL) remove_cell_width(table, cell);
+    cell->nested = subtable;
+    VEC_PUSH_ELEM(&table->nested_cells, struct Cell*, cell);
+    // Lines of nested tables are printed like lines of texts, only by the general path
+    table->num_multiline_cells++;
+}
@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "table_internal.h"
+
+static void write_to_buffer(struct Output *out, const char *bytes, size_t length)
+{
+    // Bytes that do not fit are dropped, but still counted in out->written
+    if (out->written >= out->capacity) return;
+    if (length > out->capacity - out->written) length = out->capacity - out->written;
+    memcpy((char*)out->context + out->written, bytes, length);
+}
+
+static void write_nothing(__attribute__((unused)) struct Output *out,
+    __attribute__((unused)) const char *bytes,
+    __attribute__((unused)) size_t length)
+{
+    // Only used to count bytes
+}
+
+static void drain_sink(struct SinkBuffer *buffer)
+{
+    if (buffer->length == 0) return;
+    buffer->sink->write(buffer->sink->context, buffer->chunk, buffer->length);
+    buffer->length = 0;
+}
+
+static void write_to_sink(struct Output *out, const char *bytes, size_t length)
+{
+    struct SinkBuffer *buffer = out->context;
+    if (length > TABLE_SINK_CHUNK_SIZE - buffer->length) drain_sink(buffer);
+    if (length >= TABLE_SINK_CHUNK_SIZE)
+    {
+        // Copying would not save a call
+        buffer->sink->write(buffer->sink->context, bytes, length);
+        return;
+    }
+    memcpy(buffer->chunk + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+static void spaces_to_sink(struct Output *out, size_t count)
+{
+    struct SinkBuffer *buffer = out->context;
+    while (count > 0)
+    {
+        if (buffer->length == TABLE_SINK_CHUNK_SIZE) drain_sink(buffer);
+        size_t chunk = count < TABLE_SINK_CHUNK_SIZE - buffer->length ? count : TABLE_SINK_CHUNK_SIZE - buffer->length;
+        memset(buffer->chunk + buffer->length, ' ', chunk);
+        buffer->length += chunk;
+        count -= chunk;
+    }
+}
+
+static void write_to_stream_sink(void *context, const char *bytes, size_t length)
+{
+    fwrite(bytes, 1, length, (FILE*)context);
+}
+
+/*
+Summary: Sink that writes to stream, which is not flushed. All fprint_ functions print through it.
+*/
+TableSink get_stream_sink(FILE *stream)
+{
+    return (TableSink){
+        .write       = write_to_stream_sink,
+        .flush       = NULL,
+        .context     = stream,
+        .is_terminal = isatty(fileno(stream))
+    };
+}
+
+/*
+Summary: Output that coalesces writes in buffer before they reach sink, finish_sink hands over the rest.
+    buffer must not move while the output is used.
+*/
+struct Output output_from_sink(struct SinkBuffer *buffer, const TableSink *sink)
+{
+    buffer->sink = sink;
+    buffer->length = 0;
+    return (struct Output){
+        .write       = write_to_sink,
+        .spaces      = spaces_to_sink,
+        .context     = buffer,
+        .is_terminal = sink->is_terminal
+    };
+}
+
+void finish_sink(struct SinkBuffer *buffer)
+{
+    drain_sink(buffer);
+    if (buffer->sink->flush != NULL) buffer->sink->flush(buffer->sink->context);
+}
+
+struct Output output_from_buffer(char *buffer, size_t capacity)
+{
+    return (struct Output){ .write = write_to_buffer, .context = buffer, .capacity = capacity };
+}
+
+struct Output output_counting()
+{
+    return (struct Output){ .write = write_nothing };
+}
+
+// Cursor movement needs at least 4 bytes, so only longer runs are replaced
+#define CURSOR_FORWARD_MIN 5
+
+static void flush_pending(struct Compactor *compactor)
+{
+    if (compactor->pending == 0) return;
+    if ((compactor->mode & COMPACT_CURSOR_FORWARD) && compactor->target->is_terminal
+        && compactor->pending >= CURSOR_FORWARD_MIN)
+    {
+        char sequence[32];
+        out_write(compactor->target, sequence, snprintf(sequence, sizeof(sequence), "\033[%zuC", compactor->pending));
+    }
+    else
+    {
+        out_spaces(compactor->target, compactor->pending);
+    }
+    compactor->pending = 0;
+}
+
+// Spaces at end of bytes are held back until it is known whether the line continues
+static void compact_bytes(struct Output *out, const char *bytes, size_t length, bool is_text)
+{
+    struct Compactor *compactor = out->context;
+    while (length > 0)
+    {
+        const char *newline = memchr(bytes, '\n', length);
+        size_t segment = newline != NULL ? (size_t)(newline - bytes) : length;
+        size_t end = segment;
+        while (end > 0 && bytes[end - 1] == ' ') end--;
+
+        if (end > 0)
+        {
+            flush_pending(compactor);
+            if (is_text) out_text(compactor->target, bytes, end);
+            else out_write(compactor->target, bytes, end);
+        }
+        compactor->pending += segment - end;
+        if (newline == NULL) break;
+
+        if (compactor->mode & COMPACT_TRIM) compactor->pending = 0;
+        flush_pending(compactor);
+        out_write(compactor->target, "\n", 1);
+        bytes += segment + 1;
+        length -= segment + 1;
+    }
+}
+
+static void compact_write(struct Output *out, const char *bytes, size_t length)
+{
+    compact_bytes(out, bytes, length, false);
+}
+
+static void compact_text(struct Output *out, const char *bytes, size_t length)
+{
+    compact_bytes(out, bytes, length, true);
+}
+
+static void compact_spaces(struct Output *out, size_t count)
+{
+    ((struct Compactor*)out->context)->pending += count;
+}
+
+/*
+Summary: Output that forwards to compactor->target with minimized whitespace. Bytes are counted by the target.
+    Lines are expected to end with \n, spaces pending at the end are dropped.
+*/
+struct Output output_compacting(struct Compactor *compactor)
+{
+    return (struct Output){
+        .write   = compact_write,
+        .text    = compact_text,
+        .spaces  = compact_spaces,
+        .context = compactor
+    };
+}
+
+void out_write(struct Output *out, const char *bytes, size_t length)
+{
+    out->write(out, bytes, length);
+    out->written += length;
+}
+
+void out_string(struct Output *out, const char *string)
+{
+    out_write(out, string, strlen(string));
+}
+
+// Bytes of a cell text, which outlive the output
+void out_text(struct Output *out, const char *bytes, size_t length)
+{
+    if (out->text == NULL)
+    {
+        out_write(out, bytes, length);
+        return;
+    }
+    out->text(out, bytes, length);
+    out->written += length;
+}
+
+void out_spaces(struct Output *out, size_t count)
+{
+    if (out->spaces != NULL)
+    {
+        out->spaces(out, count);
+        out->written += count;
+        return;
+    }
+
+    static const char SPACES[] = "                                                                ";
+    while (count > 0)
+    {
+        size_t chunk = count < sizeof(SPACES) - 1 ? count : sizeof(SPACES) - 1;
+        out_write(out, SPACES, chunk);
+        count -= chunk;
+    }
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "string_util.h"
+#include "table_internal.h"
+
+/*
+ * Cells in columns with a maximum width or number of lines are shown as display lines,
+ * which are found by scanning at most as many columns as are shown (memchr finds the end of a cut line).
+ * Color codes take no columns and are never split.
+ */
+
+/*
+Summary: Limits the width of cells in col, wider cells are truncated or wrapped. 0 removes the limit.
+    Limits are applied when printing, texts of cells are not changed.
+*/
+void set_max_width(Table *table, size_t col, size_t max_width, TableOverflow overflow)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    table->max_widths[col] = max_width;
+    table->overflows[col] = overflow;
+    table->version++;
+    // Cells may be wider with the new limit
+    if (table->fixed_widths[col] != 0) set_fixed_width(table, col, table->fixed_widths[col]);
+}
+
+/*
+Summary: Limits the number of lines a cell in col shows, the last shown line of a longer cell ends with an ellipsis.
+    0 removes the limit.
+*/
+void set_max_lines(Table *table, size_t col, size_t max_lines)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    table->max_lines[col] = max_lines;
+    table->version++;
+    // Cells may be wider with the new limit
+    if (table->fixed_widths[col] != 0) set_fixed_width(table, col, table->fixed_widths[col]);
+}
+
+bool has_limits(const Table *table, const struct Cell *cell)
+{
+    // Nested tables are never cut
+    return cell->nested == NULL && (table->max_widths[cell->x] != 0 || table->max_lines[cell->x] != 0);
+}
+
+/*
+Summary: Skips columns of a line, color codes after the last skipped column are not skipped.
+Returns: Number of bytes skipped
+*/
+size_t take_columns(const char *start, const char *end, size_t columns)
+{
+    const char *curr = start;
+    while (curr < end && *curr != '\n')
+    {
+        if (*curr == '\033')
+        {
+            if (columns == 0) break;
+            curr = skip_ansi_bounded(curr, end);
+            continue;
+        }
+        if (columns == 0) break;
+        columns--;
+        curr++;
+    }
+    return curr - start;
+}
+
+// Returns: Columns of the ellipsis in columns, a wide ellipsis is cut to fit
+size_t get_ellipsis_width(const Table *table, size_t columns)
+{
+    return table->glyphs.ellipsis_width < columns ? table->glyphs.ellipsis_width : columns;
+}
+
+/*
+Summary: Finds display line of cell beginning at start, which is the text of cell or next of the previous display line.
+*/
+void get_display_line(const Table *table, const struct Cell *cell, const char *start, struct DisplayLine *out_line)
+{
+    const char *end = cell->text + cell->text_length;
+    size_t max_width = table->max_widths[cell->x] != 0 ? table->max_widths[cell->x] : SIZE_MAX;
+
+    const char *curr = start;
+    const char *space = NULL; // Last space a wrapped line can be broken at
+    size_t space_width = 0;
+    size_t width = 0;
+    while (curr < end && *curr != '\n')
+    {
+        if (*curr == '\033')
+        {
+            curr = skip_ansi_bounded(curr, end);
+            continue;
+        }
+        if (width == max_width) break;
+        if (*curr == ' ')
+        {
+            space = curr;
+            space_width = width;
+        }
+        width++;
+        curr++;
+    }
+
+    *out_line = (struct DisplayLine){ .start = start, .length = curr - start, .width = width, .is_cut = false };
+    if (curr == end || *curr == '\n')
+    {
+        out_line->next = curr < end ? curr + 1 : NULL;
+    }
+    else if (table->overflows[cell->x] == OVERFLOW_TRUNCATE)
+    {
+        // Ellipsis takes the last columns
+        size_t ellipsis_width = get_ellipsis_width(table, max_width);
+        out_line->length = take_columns(start, curr, max_width - ellipsis_width);
+        out_line->width = max_width - ellipsis_width;
+        out_line->is_cut = true;
+        const char *newline = memchr(curr, '\n', end - curr);
+        out_line->next = newline != NULL ? newline + 1 : NULL;
+    }
+    else if (*curr == ' ')
+    {
+        out_line->next = curr + 1;
+    }
+    else if (space != NULL)
+    {
+        out_line->length = space - start;
+        out_line->width = space_width;
+        out_line->next = space + 1;
+    }
+    else
+    {
+        out_line->next = curr;
+    }
+}
+
+/*
+Summary: Size of cell in layout with limits of its column applied. Only wrapped cells are scanned,
+    up to the maximum number of lines.
+*/
+void get_limited_size(const Table *table, const struct Cell *cell, size_t *out_width, size_t *out_height)
+{
+    size_t max_width = table->max_widths[cell->x];
+    size_t max_lines = table->max_lines[cell->x];
+    *out_width = max_width != 0 && max_width < cell->text_width ? max_width : cell->text_width;
+    *out_height = cell->text_height;
+
+    if (max_width != 0 && table->overflows[cell->x] == OVERFLOW_WRAP && cell->text != NULL)
+    {
+        *out_height = 0;
+        const char *start = cell->text;
+        while (start != NULL && (max_lines == 0 || *out_height <= max_lines))
+        {
+            struct DisplayLine line;
+            get_display_line(table, cell, start, &line);
+            start = line.next;
+            (*out_height)++;
+        }
+    }
+
+    // Ellipsis of the last line needs a column
+    if (max_lines != 0 && *out_height > max_lines)
+    {
+        *out_height = max_lines;
+        if (*out_width == 0) *out_width = 1;
+    }
+}
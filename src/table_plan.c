@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * A plan is the rendering of a table recorded as a flat list of emit operations.
+ * Layout, alignments and borders are resolved once when freezing, so executing a plan only copies bytes.
+ * Plans are never changed after freezing and can be executed by any number of threads at once.
+ */
+
+enum PlanOpKind
+{
+    PLAN_LITERAL, // Run of glyphs and newlines, stored in literal pool of plan
+    PLAN_PADDING, // Run of spaces
+    PLAN_TEXT     // Slice of a cell text, not copied
+};
+
+struct PlanOp
+{
+    enum PlanOpKind kind;
+    size_t length;
+    size_t offset;    // PLAN_LITERAL: Offset into literal pool
+    const char *text; // PLAN_TEXT
+};
+
+struct TablePlan
+{
+    Table *table;
+    Vector ops;      // struct PlanOp
+    Vector literals; // char
+    size_t size;     // Number of bytes emitted by plan
+};
+
+static struct PlanOp *get_last_op(TablePlan *plan, enum PlanOpKind kind)
+{
+    struct PlanOp *last = vec_count(&plan->ops) > 0 ? vec_peek(&plan->ops) : NULL;
+    return last != NULL && last->kind == kind ? last : NULL;
+}
+
+static void record_literal(struct Output *out, const char *bytes, size_t length)
+{
+    TablePlan *plan = out->context;
+    // Literals are appended to pool in order, so a run continues at end of pool
+    struct PlanOp *last = get_last_op(plan, PLAN_LITERAL);
+    if (last != NULL)
+    {
+        last->length += length;
+    }
+    else
+    {
+        VEC_PUSH_ELEM(&plan->ops, struct PlanOp, ((struct PlanOp){
+            .kind   = PLAN_LITERAL,
+            .length = length,
+            .offset = vec_count(&plan->literals)
+        }));
+    }
+    vec_push_many(&plan->literals, length, (void*)bytes);
+}
+
+static void record_text(struct Output *out, const char *bytes, size_t length)
+{
+    if (length == 0) return;
+    TablePlan *plan = out->context;
+    VEC_PUSH_ELEM(&plan->ops, struct PlanOp, ((struct PlanOp){ .kind = PLAN_TEXT, .length = length, .text = bytes }));
+}
+
+static void record_spaces(struct Output *out, size_t count)
+{
+    if (count == 0) return;
+    TablePlan *plan = out->context;
+    struct PlanOp *last = get_last_op(plan, PLAN_PADDING);
+    if (last != NULL)
+    {
+        last->length += count;
+    }
+    else
+    {
+        VEC_PUSH_ELEM(&plan->ops, struct PlanOp, ((struct PlanOp){ .kind = PLAN_PADDING, .length = count }));
+    }
+}
+
+static void execute_plan(const TablePlan *plan, struct Output *out)
+{
+    const char *literals = plan->literals.buffer;
+    for (size_t i = 0; i < vec_count(&plan->ops); i++)
+    {
+        const struct PlanOp *op = vec_get(&plan->ops, i);
+        switch (op->kind)
+        {
+            case PLAN_LITERAL:
+                out_write(out, literals + op->offset, op->length);
+                break;
+            case PLAN_PADDING:
+                out_spaces(out, op->length);
+                break;
+            case PLAN_TEXT:
+                out_write(out, op->text, op->length);
+        }
+    }
+}
+
+/*
+Summary: Compiles the current state of table into a read-only plan that prints exactly like fprint_table.
+    Cell texts are referenced, not copied: The plan must be freed before the table and reflects no later changes.
+    Rows removed from table while it has plans are freed with the last of them.
+*/
+TablePlan *table_freeze(Table *table)
+{
+    assert(table != NULL);
+    TablePlan *plan = table_alloc(table, sizeof(TablePlan));
+    *plan = (TablePlan){
+        .table    = table,
+        .ops      = vec_create_with_allocator(sizeof(struct PlanOp), 64, &table->allocator),
+        .literals = vec_create_with_allocator(sizeof(char), 256, &table->allocator)
+    };
+
+    struct Output recorder = {
+        .write   = record_literal,
+        .text    = record_text,
+        .spaces  = record_spaces,
+        .context = plan
+    };
+    render_table(table, &recorder);
+    table->num_plans++;
+    plan->size = recorder.written;
+    vec_trim(&plan->ops);
+    vec_trim(&plan->literals);
+    return plan;
+}
+
+// Can be called concurrently for the same plan
+void fprint_table_plan(const TablePlan *plan, FILE *stream)
+{
+    assert(plan != NULL);
+    assert(stream != NULL);
+    TableSink sink = get_stream_sink(stream);
+    struct SinkBuffer buffer;
+    struct Output out = output_from_sink(&buffer, &sink);
+    execute_plan(plan, &out);
+    finish_sink(&buffer);
+}
+
+// Returns: Number of bytes printed by plan
+size_t table_plan_size(const TablePlan *plan)
+{
+    assert(plan != NULL);
+    return plan->size;
+}
+
+/*
+Summary: Like table_render_into, but executes plan.
+Returns: Number of bytes of the whole rendering, i.e. a result > size indicates truncation
+*/
+size_t table_plan_render_into(const TablePlan *plan, char *buf, size_t size)
+{
+    assert(plan != NULL);
+    assert(buf != NULL || size == 0);
+    struct Output out = output_from_buffer(buf, size);
+    execute_plan(plan, &out);
+    return out.written;
+}
+
+void free_table_plan(TablePlan *plan)
+{
+    assert(plan != NULL);
+    vec_destroy(&plan->ops);
+    vec_destroy(&plan->literals);
+    Table *table = plan->table;
+    table_free(table, plan);
+    if (--table->num_plans == 0) free_retired_rows(table);
+}
@@ -0,0 +1,288 @@
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Rows can be removed from and inserted into the linked list of rows, as long as no cell spans over
+ * several rows at that position. A table with a row capacity evicts its first row whenever a row is appended
+ * beyond the capacity. Such tables count the widths of their cells per col, so layouts of tables without spans
+ * and limits are computed without reading rows (see get_dimensions in table.c).
+ */
+
+// Widths below are counted in an array, wider cells are rare and kept in a list
+#define HISTOGRAM_WIDTHS 256
+
+struct WidthHistogram
+{
+    size_t counts[HISTOGRAM_WIDTHS]; // Set cells of each width
+    size_t max_width;                // Widest cell counted in counts
+    Vector wide_widths;              // size_t widths of cells at least HISTOGRAM_WIDTHS wide, unordered
+};
+
+void add_cell_width(Table *table, const struct Cell *cell)
+{
+    struct WidthHistogram *histogram = &table->histograms[cell->x];
+    if (cell->text_width < HISTOGRAM_WIDTHS)
+    {
+        histogram->counts[cell->text_width]++;
+        if (cell->text_width > histogram->max_width) histogram->max_width = cell->text_width;
+    }
+    else
+    {
+        VEC_PUSH_ELEM(&histogram->wide_widths, size_t, cell->text_width);
+    }
+}
+
+void remove_cell_width(Table *table, const struct Cell *cell)
+{
+    struct WidthHistogram *histogram = &table->histograms[cell->x];
+    if (cell->text_width < HISTOGRAM_WIDTHS)
+    {
+        histogram->counts[cell->text_width]--;
+        while (histogram->max_width > 0 && histogram->counts[histogram->max_width] == 0) histogram->max_width--;
+        return;
+    }
+
+    for (size_t i = 0; i < vec_count(&histogram->wide_widths); i++)
+    {
+        size_t *width = vec_get(&histogram->wide_widths, i);
+        if (*width == cell->text_width)
+        {
+            *width = *(size_t*)vec_pop(&histogram->wide_widths);
+            break;
+        }
+    }
+}
+
+// Returns: Width of widest set cell in col
+size_t get_max_cell_width(const Table *table, size_t col)
+{
+    const struct WidthHistogram *histogram = &table->histograms[col];
+    size_t res = histogram->max_width;
+    for (size_t i = 0; i < vec_count(&histogram->wide_widths); i++)
+    {
+        size_t width = *(size_t*)vec_get(&histogram->wide_widths, i);
+        if (width > res) res = width;
+    }
+    return res;
+}
+
+void free_histograms(Table *table)
+{
+    if (table->histograms == NULL) return;
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++) vec_destroy(&table->histograms[i].wide_widths);
+    table_free(table, table->histograms);
+    table->histograms = NULL;
+}
+
+// Frees row, which is not linked any more, and everything table counts of it
+static void release_row(Table *table, struct Row *row)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        struct Cell *cell = &row->cells[i];
+        if (cell->override_border_left && cell->border_left != BORDER_NONE) table->border_left_counters[i]--;
+        if (table->histograms != NULL && cell->is_set && cell->nested == NULL) remove_cell_width(table, cell);
+        if (cell->nested != NULL) remove_nested_cell(table, cell);
+        if (cell->text_needs_free) table->resident_bytes -= cell->text_length;
+    }
+    table->resident_bytes -= sizeof(struct Row);
+    table->num_rows--;
+    table->version++;
+    retire_row(table, row);
+}
+
+// Frees row, which is not linked any more, or keeps it until the plans printing its texts are freed
+void retire_row(Table *table, struct Row *row)
+{
+    if (table->num_plans > 0) VEC_PUSH_ELEM(&table->retired_rows, struct Row*, row);
+    else free_row(table, row);
+}
+
+void free_retired_rows(Table *table)
+{
+    for (size_t i = 0; i < vec_count(&table->retired_rows); i++)
+    {
+        free_row(table, *(struct Row**)vec_get(&table->retired_rows, i));
+    }
+    vec_clear(&table->retired_rows);
+}
+
+#ifndef NDEBUG
+// Checks of assertions
+
+// True iff a cell spans from a row before index into row index or beyond
+static bool is_spanned_into(const Table *table, size_t index)
+{
+    struct SpanSweep spans;
+    init_spans(&spans);
+    struct Row *row = table->first_row;
+    for (size_t i = 0; i < index; i++)
+    {
+        advance_spans(&spans, row);
+        row = row->next_row;
+    }
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        // Spans of the previous row are only left after advancing to row
+        if (spans.covering[i] != NULL && spans.rows_left[i] > 0) return true;
+    }
+    return false;
+}
+
+static bool begins_span_y(const struct Row *row)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        if (row->cells[i].span_y > 1) return true;
+    }
+    return false;
+}
+#endif
+
+// Called when a row was appended to a table with a row capacity
+void evict_rows(Table *table)
+{
+    while (table->num_rows > table->row_capacity)
+    {
+        struct Row *row = table->first_row;
+        assert(row != table->curr_row);
+        table->first_row = row->next_row;
+        release_row(table, row);
+    }
+}
+
+/*
+Summary: Keeps at most capacity rows in table, rows beyond it are evicted oldest first whenever a row is appended.
+    Widths of cells are counted from now on, so evicting a row does not need to measure the others.
+    Cells must not span over several rows. 0 removes the capacity, rows are kept then.
+    Tables with a memory budget or rows published concurrently can not have a capacity.
+*/
+void set_row_capacity(Table *table, size_t capacity)
+{
+    assert(table != NULL);
+    assert(table->spill == NULL);
+    table->row_capacity = capacity;
+    if (capacity == 0)
+    {
+        free_histograms(table);
+        return;
+    }
+
+    if (table->histograms == NULL)
+    {
+        table->histograms = table_alloc(table, TABLE_MAX_COLS * sizeof(struct WidthHistogram));
+        for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+        {
+            table->histograms[i] = (struct WidthHistogram){
+                .counts      = { 0 },
+                .max_width   = 0,
+                .wide_widths = vec_create_with_allocator(sizeof(size_t), 1, &table->allocator)
+            };
+        }
+        for (struct Row *row = table->first_row; row != NULL; row = row->next_row)
+        {
+            assert(!begins_span_y(row));
+            for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+            {
+                const struct Cell *cell = &row->cells[i];
+                if (cell->is_set && cell->nested == NULL) add_cell_width(table, cell);
+            }
+        }
+    }
+
+    if (table->num_rows > capacity)
+    {
+        // A cursor in an evicted row moves to the last row
+        struct Row *row = table->first_row;
+        for (size_t i = capacity; i < table->num_rows; i++)
+        {
+            if (row == table->curr_row)
+            {
+                table->curr_row = table->last_row;
+                table->curr_col = 0;
+            }
+            row = row->next_row;
+        }
+        evict_rows(table);
+        reset_cursor_spans(table);
+    }
+}
+
+/*
+Summary: Inserts an empty row before row index, index == number of rows appends it. The cursor moves to it.
+    No cell may span over the position. A full table with a row capacity evicts its first row,
+    so rows are not inserted at index 0 of it.
+*/
+void table_insert_row(Table *table, size_t index)
+{
+    assert(table != NULL);
+    assert(index <= table->num_rows);
+    assert(get_num_spilled(table) == 0);
+    assert(!is_spanned_into(table, index));
+    assert(table->row_capacity == 0 || table->num_rows < table->row_capacity || index > 0);
+
+    struct Row *row = malloc_row(table);
+    if (index == 0)
+    {
+        row->next_row = table->first_row;
+        table->first_row = row;
+    }
+    else
+    {
+        struct Row *prev = table->first_row;
+        for (size_t i = 1; i < index; i++) prev = prev->next_row;
+        row->next_row = prev->next_row;
+        prev->next_row = row;
+        if (prev == table->last_row) table->last_row = row;
+    }
+    table->num_rows++;
+    table->resident_bytes += sizeof(struct Row);
+    table->version++;
+
+    table->curr_row = row;
+    table->curr_col = 0;
+    if (table->row_capacity != 0) evict_rows(table);
+    reset_cursor_spans(table);
+}
+
+/*
+Summary: Removes row index and frees its texts like free_table. No cell may span into, out of or over the row.
+    The cursor moves to the first col of the following row (or the previous one) if it was in the removed row.
+    The only row of a table is replaced by an empty one.
+*/
+void table_delete_row(Table *table, size_t index)
+{
+    assert(table != NULL);
+    assert(index < table->num_rows);
+    assert(get_num_spilled(table) == 0);
+    assert(!is_spanned_into(table, index));
+
+    struct Row *prev = NULL;
+    struct Row *row = table->first_row;
+    for (size_t i = 0; i < index; i++)
+    {
+        prev = row;
+        row = row->next_row;
+    }
+    assert(!begins_span_y(row));
+
+    struct Row *next = row->next_row;
+    if (next == NULL && prev == NULL)
+    {
+        // A table always has a row
+        next = malloc_row(table);
+        table->num_rows++;
+        table->resident_bytes += sizeof(struct Row);
+    }
+    if (prev == NULL) table->first_row = next;
+    else prev->next_row = next;
+    if (row == table->last_row) table->last_row = next != NULL ? next : prev;
+    if (row == table->curr_row)
+    {
+        table->curr_row = next != NULL ? next : prev;
+        table->curr_col = 0;
+    }
+    release_row(table, row);
+    reset_cursor_spans(table);
+}
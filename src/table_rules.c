@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "string_util.h"
+#include "table_internal.h"
+
+/*
+ * Style rules choose style and alignment of cells of a col by their texts while printing, so texts stay plain
+ * and are measured without color codes. Rules of a col are checked in the order they were added, the first
+ * matching rule applies. Styles and alignments overridden for single cells take precedence over rules.
+ */
+
+static bool matches(const TableStyleRule *rule, const char *text, size_t length)
+{
+    double number;
+    switch (rule->kind)
+    {
+        case RULE_BELOW:
+            return parse_number(text, length, &number) && number < rule->threshold;
+        case RULE_ABOVE:
+            return parse_number(text, length, &number) && number > rule->threshold;
+        case RULE_PREFIX:
+        {
+            size_t prefix_length = strlen(rule->prefix);
+            return length >= prefix_length && memcmp(text, rule->prefix, prefix_length) == 0;
+        }
+        case RULE_CALLBACK:
+            return rule->predicate(text, length, rule->context);
+    }
+    return false;
+}
+
+/*
+Summary: Adds a rule that gives cells of col a style or alignment when their text matches. Rules are checked
+    once per cell whenever the table is printed, the first matching rule of col applies.
+*/
+void add_style_rule(Table *table, size_t col, const TableStyleRule *rule)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    assert(rule != NULL);
+    assert(rule->kind != RULE_PREFIX || rule->prefix != NULL);
+    assert(rule->kind != RULE_CALLBACK || rule->predicate != NULL);
+
+    VEC_PUSH_ELEM(&table->style_rules, struct StyleRule, ((struct StyleRule){
+        .col  = col,
+        .rule = *rule,
+        .attr = rule->sets_style ? encode_style(rule->style) : ATTR_DEFAULT
+    }));
+    table->num_style_rules[col]++;
+    table->version++;
+}
+
+/*
+Summary: Determines the defaults cell is printed with, which are the style and alignment of its col
+    as changed by the first matching rule. Overrides of cell still apply to them.
+*/
+void apply_style_rules(const Table *table, const struct Cell *cell, uint16_t *out_attr, TableHAlign *out_h_align)
+{
+    size_t col = cell->x;
+    *out_attr = table->attrs[col];
+    *out_h_align = table->h_aligns[col];
+    if (table->num_style_rules[col] == 0 || cell->text == NULL) return;
+
+    for (size_t i = 0; i < vec_count(&table->style_rules); i++)
+    {
+        const struct StyleRule *style_rule = vec_get(&table->style_rules, i);
+        if (style_rule->col != col || !matches(&style_rule->rule, cell->text, cell->text_length)) continue;
+
+        if (style_rule->rule.sets_style) *out_attr = style_rule->attr;
+        if (style_rule->rule.sets_h_align) *out_h_align = style_rule->rule.h_align;
+        return;
+    }
+}
@@ -0,0 +1,75 @@
+#include <assert.h>
+
+#include "table_schema.h"
+#include "table_internal.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/*
+ * Tables declared with TABLE_SCHEMA (see table_schema.h) have the same cols in every row, their cells never span
+ * or take several lines. They are printed by the path for simple tables in table.c, numbers are added as plain
+ * cells and cols with a fixed width are left out when the layout measures cells. A fixed width grows to the cells
+ * of its col as they are added, so a name or value wider than it widens the col instead of overflowing it.
+ */
+
+/*
+Summary: Creates a table whose cols have the names, fixed widths and alignments of cols.
+    The names form the first row, which is separated from the following rows by a single hline.
+*/
+Table *get_schema_table(size_t num_cols, const TableSchemaCol *cols)
+{
+    assert(num_cols > 0 && num_cols <= TABLE_MAX_COLS);
+    assert(cols != NULL);
+    Table *table = get_empty_table();
+    for (size_t i = 0; i < num_cols; i++)
+    {
+        set_fixed_width(table, i, cols[i].width);
+        table->h_aligns[i] = cols[i].h_align;
+        add_cell(table, cols[i].name);
+    }
+    next_row(table);
+    set_hline(table, BORDER_SINGLE);
+    // Rows are appended after the current row
+    set_position(table, 0, 0);
+    return table;
+}
+
+// Adds number formatted by snprintf into buffer
+void add_schema_number(Table *table, const char *buffer, int length)
+{
+    assert(length >= 0 && length < TABLE_SCHEMA_NUMBER_LENGTH);
+    add_cell_plain(table, buffer, (size_t)length);
+}
+
+// Cells spanning several cols and nested tables are measured by the layout
+static bool has_fixed_width(const Table *table, const struct Cell *cell)
+{
+    return table->fixed_widths[cell->x] != 0 && cell->is_set && cell->span_x == 1 && cell->nested == NULL;
+}
+
+// Called when cell was set, a fixed width grows to fit it
+void fit_fixed_width(Table *table, const struct Cell *cell)
+{
+    if (!has_fixed_width(table, cell)) return;
+    size_t width;
+    size_t height;
+    get_cell_size(table, cell, &width, &height);
+    table->fixed_widths[cell->x] = MAX(table->fixed_widths[cell->x], width);
+}
+
+/*
+Summary: Gives col the given width, 0 removes it. The width grows to the widest cell of col, now and when cells
+    are added, so the layout does not measure them.
+*/
+void set_fixed_width(Table *table, size_t col, size_t width)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    table->fixed_widths[col] = width;
+    table->version++;
+    if (width == 0) return;
+
+    // Spilled rows are not read, their widest cell was recorded
+    if (table->spill != NULL) table->fixed_widths[col] = MAX(width, table->spill->col_widths[col]);
+    for (struct Row *row = table->first_row; row != NULL; row = row->next_row) fit_fixed_width(table, &row->cells[col]);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "table.h"
+
+/*
+ * Tables with a schema known at compile time. A schema is an X-macro listing the cols of the table,
+ * COL(name, kind, width, h_align) each, where kind is TEXT, INT, UINT or FLOAT and width is the fixed width
+ * of the col (0 if it is measured):
+ *
+ *     #define TRADES(COL)                      \
+ *         COL(symbol, TEXT,  0, H_ALIGN_LEFT)  \
+ *         COL(qty,    INT,   8, H_ALIGN_RIGHT) \
+ *         COL(price,  FLOAT, 0, H_ALIGN_RIGHT)
+ *     TABLE_SCHEMA(trades, TRADES)
+ *
+ * declares trades_table(), which returns a table with a header row of the names, and
+ * trades_append(table, symbol, qty, price), which appends a row. Its parameters have the types of the kinds
+ * and every col is formatted by code of its own kind, numbers are added without measuring them.
+ */
+
+// Types of the values of cols of each kind
+#define TABLE_SCHEMA_TYPE_TEXT const char *
+#define TABLE_SCHEMA_TYPE_INT long long
+#define TABLE_SCHEMA_TYPE_UINT unsigned long long
+#define TABLE_SCHEMA_TYPE_FLOAT double
+
+// Longest formatted number, including \0
+#define TABLE_SCHEMA_NUMBER_LENGTH 32
+
+// Formats value into buffer of TABLE_SCHEMA_NUMBER_LENGTH bytes and adds it as next cell of table
+#define TABLE_SCHEMA_ADD_TEXT(table, value, buffer) add_cell_fmt(table, "%s", value)
+#define TABLE_SCHEMA_ADD_INT(table, value, buffer) add_schema_number(table, buffer, snprintf(buffer, TABLE_SCHEMA_NUMBER_LENGTH, "%lld", value))
+#define TABLE_SCHEMA_ADD_UINT(table, value, buffer) add_schema_number(table, buffer, snprintf(buffer, TABLE_SCHEMA_NUMBER_LENGTH, "%llu", value))
+#define TABLE_SCHEMA_ADD_FLOAT(table, value, buffer) add_schema_number(table, buffer, snprintf(buffer, TABLE_SCHEMA_NUMBER_LENGTH, "%g", value))
+
+// Expansions of a single col
+#define TABLE_SCHEMA_COUNT_(name, kind, width, h_align) + 1
+#define TABLE_SCHEMA_COL_(name, kind, width, h_align) { #name, width, h_align },
+#define TABLE_SCHEMA_PARAM_(name, kind, width, h_align) , TABLE_SCHEMA_TYPE_##kind name
+#define TABLE_SCHEMA_CELL_(name, kind, width, h_align) TABLE_SCHEMA_ADD_##kind(table, name, buffer);
+
+#define TABLE_SCHEMA(prefix, COLS)                                                                   \
+    enum { prefix##_num_cols = 0 COLS(TABLE_SCHEMA_COUNT_) };                                        \
+    static inline Table *prefix##_table(void)                                                        \
+    {                                                                                                \
+        static const TableSchemaCol cols[] = { COLS(TABLE_SCHEMA_COL_) };                            \
+        return get_schema_table(prefix##_num_cols, cols);                                            \
+    }                                                                                                \
+    static inline void prefix##_append(Table *table COLS(TABLE_SCHEMA_PARAM_))                       \
+    {                                                                                                \
+        char buffer[TABLE_SCHEMA_NUMBER_LENGTH];                                                     \
+        (void)buffer;                                                                                \
+        next_row(table);                                                                             \
+        COLS(TABLE_SCHEMA_CELL_)                                                                     \
+    }
+
+typedef struct
+{
+    const char *name;    // Shown in the header row
+    size_t width;        // Fixed width of col, 0 if it is measured
+    TableHAlign h_align;
+} TableSchemaCol;
+
+Table *get_schema_table(size_t num_cols, const TableSchemaCol *cols);
+void add_schema_number(Table *table, const char *buffer, int length);
@@ -0,0 +1,519 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "table_internal.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/*
+ * A snapshot file holds a table in the records rows are spilled in (see table_spill.c), so loading it is
+ * mapping and validating the file. Rows in the middle are printed straight from the mapping like spilled rows,
+ * the first row and the rows cells of the middle rows do not span into are decoded into memory.
+ * The file contains no pointers, offsets are relative to its start:
+ *
+ *   SnapshotHeader | record of row 0 | records of mapped rows | records of tail rows | SnapshotMetrics
+ *   | SnapshotSpan of span_widths | SnapshotSpan of span_heights | uint64_t height of each mapped row
+ */
+
+#define SNAPSHOT_MAGIC "CTABLE\x1A\n"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304 // Reads differently on hosts of another byte order
+#define MAX_MAPPED_SPAN_Y 64 // Rows of longer spans are decoded, so readers hold few rows
+
+// Layouts of the file have no padding, all of them are copied out with memcpy
+struct SnapshotCol
+{
+    uint64_t max_width;
+    uint64_t max_lines;
+    uint64_t fixed_width;
+    int32_t border_left_counter;
+    uint16_t attr;
+    uint8_t border_left;
+    uint8_t h_align;
+    uint8_t v_align;
+    uint8_t overflow;
+    uint8_t unused[6];
+};
+
+struct SnapshotGlyph
+{
+    char bytes[4];
+    uint32_t length;
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t max_cols;        // TABLE_MAX_COLS of writer
+    uint32_t compact_mode;
+    uint64_t num_rows;
+    uint64_t num_cols;
+    uint64_t num_content_cols;
+    uint64_t num_mapped;      // Rows 1 to num_mapped are printed from the mapping
+    uint64_t mapped_offset;   // Record of row 1
+    uint64_t tail_offset;     // Record of row num_mapped + 1
+    uint64_t metrics_offset;
+    uint64_t file_length;
+    struct SnapshotCol cols[TABLE_MAX_COLS];
+    struct SnapshotGlyph single_border[NUM_GLYPHS];
+    struct SnapshotGlyph double_border[NUM_GLYPHS];
+};
+
+// Layout metrics of mapped rows, see struct Spill
+struct SnapshotMetrics
+{
+    uint64_t col_widths[TABLE_MAX_COLS];
+    uint64_t num_span_widths;
+    uint64_t num_span_heights;
+};
+
+struct SnapshotSpan
+{
+    uint64_t from_index;
+    uint64_t to_index;
+    uint64_t size;
+};
+
+static size_t get_max_span_y(const struct Row *row)
+{
+    size_t res = 1;
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++) res = MAX(res, row->cells[i].span_y);
+    return res;
+}
+
+static bool fits_record(const struct Row *row)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        if (row->cells[i].text_length > UINT32_MAX || row->cells[i].span_y > UINT32_MAX) return false;
+    }
+    return true;
+}
+
+/*
+Summary: Finds where the mapped rows end. Cells of mapped rows must not span into rows decoded on load,
+    whose hlines can still change, and the last row is always decoded, so rows can be appended after loading.
+    Mapped rows end before the first cell spanning over more than MAX_MAPPED_SPAN_Y rows.
+Returns: Index of first tail row, number of rows in out_num_rows. 0 if a row does not fit into a record.
+*/
+static size_t find_tail(const Table *table, struct SpillReader *reader, size_t *out_num_rows)
+{
+    size_t tail = 1;
+    size_t reach = 0; // First row that no cell of the rows visited so far spans into
+    bool is_mapping = true;
+    size_t index = 0;
+    for (const struct Row *row = table->first_row; row != NULL; row = get_following_row(table, reader, ++index, row))
+    {
+        if (!fits_record(row)) return 0;
+        if (is_mapping && index > 0 && reach <= index) tail = index;
+        size_t span_y = get_max_span_y(row);
+        reach = MAX(reach, index + span_y);
+        if (span_y > MAX_MAPPED_SPAN_Y) is_mapping = false;
+    }
+    *out_num_rows = index;
+    return tail;
+}
+
+static void write_span(FILE *file, const struct SpanSize *span)
+{
+    struct SnapshotSpan written = { .from_index = span->from_index, .to_index = span->to_index, .size = span->size };
+    fwrite(&written, sizeof(written), 1, file);
+}
+
+static void write_metrics(FILE *file, const struct Spill *metrics)
+{
+    struct SnapshotMetrics written = {
+        .num_span_widths  = vec_count(&metrics->span_widths),
+        .num_span_heights = vec_count(&metrics->span_heights)
+    };
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++) written.col_widths[i] = metrics->col_widths[i];
+    fwrite(&written, sizeof(written), 1, file);
+
+    for (size_t i = 0; i < vec_count(&metrics->span_widths); i++) write_span(file, vec_get(&metrics->span_widths, i));
+    for (size_t i = 0; i < vec_count(&metrics->span_heights); i++) write_span(file, vec_get(&metrics->span_heights, i));
+    for (size_t i = 0; i < vec_count(&metrics->row_heights); i++)
+    {
+        uint64_t height = *(size_t*)vec_get(&metrics->row_heights, i);
+        fwrite(&height, sizeof(height), 1, file);
+    }
+}
+
+static void fill_header(const Table *table, struct SnapshotHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->byte_order = SNAPSHOT_BYTE_ORDER;
+    header->max_cols = TABLE_MAX_COLS;
+    header->compact_mode = table->compact_mode;
+    header->num_cols = table->num_cols;
+    header->num_content_cols = table->num_content_cols;
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        header->cols[i] = (struct SnapshotCol){
+            .max_width           = table->max_widths[i],
+            .max_lines           = table->max_lines[i],
+            .fixed_width         = table->fixed_widths[i],
+            .border_left_counter = table->border_left_counters[i],
+            .attr                = table->attrs[i],
+            .border_left         = table->borders_left[i],
+            .h_align             = table->h_aligns[i],
+            .v_align             = table->v_aligns[i],
+            .overflow            = table->overflows[i]
+        };
+    }
+    for (size_t i = 0; i < NUM_GLYPHS; i++)
+    {
+        memcpy(header->single_border[i].bytes, table->glyphs.single_border[i].bytes, 4);
+        header->single_border[i].length = table->glyphs.single_border[i].length;
+        memcpy(header->double_border[i].bytes, table->glyphs.double_border[i].bytes, 4);
+        header->double_border[i].length = table->glyphs.double_border[i].length;
+    }
+}
+
+/*
+Summary: Writes rows of table as records and collects layout metrics of the mapped ones.
+    Heights of cells spanning over several rows are weakened once all hlines of the mapped rows are known.
+*/
+static void write_rows(FILE *file, Table *table, struct SpillReader *reader, size_t tail,
+    struct SnapshotHeader *header, struct Spill *metrics)
+{
+    Vector has_hlines = vec_create_with_allocator(sizeof(bool), 256, &table->allocator);
+    size_t index = 0;
+    for (const struct Row *row = table->first_row; row != NULL; row = get_following_row(table, reader, ++index, row))
+    {
+        if (index == 1) header->mapped_offset = ftell(file);
+        if (index == tail) header->tail_offset = ftell(file);
+        if (index > 0 && index < tail)
+        {
+            add_row_metrics(table, metrics, row, index);
+            VEC_PUSH_ELEM(&has_hlines, bool, row->border_above_counter > 0);
+        }
+        encode_row(&metrics->record, row);
+        fwrite(metrics->record.buffer, 1, vec_count(&metrics->record), file);
+    }
+    if (index <= 1) header->mapped_offset = ftell(file);
+    if (index <= tail) header->tail_offset = ftell(file);
+
+    for (size_t i = 0; i < vec_count(&metrics->span_heights); i++)
+    {
+        struct SpanSize *span = vec_get(&metrics->span_heights, i);
+        for (size_t j = span->from_index + 1; j < span->to_index && span->size > 0; j++)
+        {
+            if (*(bool*)vec_get(&has_hlines, j - 1)) span->size--;
+        }
+    }
+    vec_destroy(&has_hlines);
+}
+
+/*
+Summary: Saves table into a snapshot file that table_load_mapped loads without inserting cells again.
+    Layout metrics are computed with the current limits of cols. Rows must not be published concurrently.
+Returns: False if file could not be written, a cell is too large for the format (4 GiB of text)
+    or table has nested tables
+*/
+bool table_save(Table *table, const char *path)
+{
+    assert(table != NULL);
+    assert(path != NULL);
+    if (vec_count(&table->nested_cells) > 0) return false;
+    struct SpillReader *reader = open_spill_reader(table);
+    if (reader == NULL && get_num_spilled(table) > 0) return false;
+    size_t num_rows = 0;
+    size_t tail = find_tail(table, reader, &num_rows);
+    FILE *file = tail != 0 ? fopen(path, "wb") : NULL;
+    if (file == NULL)
+    {
+        close_spill_reader(reader);
+        return false;
+    }
+
+    struct SnapshotHeader header;
+    fill_header(table, &header);
+    header.num_rows = num_rows;
+    header.num_mapped = tail - 1;
+    fwrite(&header, sizeof(header), 1, file);
+
+    struct Spill *metrics = create_spill(table, NULL);
+    write_rows(file, table, reader, tail, &header, metrics);
+    header.metrics_offset = ftell(file);
+    write_metrics(file, metrics);
+    header.file_length = ftell(file);
+    free_spill(table, metrics);
+    close_spill_reader(reader);
+
+    // Offsets are known once everything else is written
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+    bool success = !ferror(file);
+    return fclose(file) == 0 && success;
+}
+
+static bool is_valid_header(const struct SnapshotHeader *header, size_t length)
+{
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->version != SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER) return false;
+    if (header->max_cols != TABLE_MAX_COLS || header->file_length != length) return false;
+    if (header->compact_mode > (COMPACT_TRIM | COMPACT_CURSOR_FORWARD)) return false;
+    if (header->num_cols > TABLE_MAX_COLS || header->num_content_cols > header->num_cols) return false;
+    // First and last row are decoded, rows in between may be mapped
+    if (header->num_rows == 0 || (header->num_mapped > 0 && header->num_mapped + 2 > header->num_rows)) return false;
+    if (header->mapped_offset < sizeof(*header) || header->mapped_offset > header->tail_offset
+        || header->tail_offset > header->metrics_offset || header->metrics_offset > length)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct SnapshotCol *col = &header->cols[i];
+        if (col->border_left > BORDER_DOUBLE || col->h_align > H_ALIGN_CENTER || col->v_align > V_ALIGN_CENTER
+            || col->overflow > OVERFLOW_WRAP || !is_valid_attr(col->attr))
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < NUM_GLYPHS; i++)
+    {
+        if (header->single_border[i].length == 0 || header->single_border[i].length > 4) return false;
+        if (header->double_border[i].length == 0 || header->double_border[i].length > 4) return false;
+    }
+    return true;
+}
+
+/*
+Summary: Checks that records of all rows lie between the offsets of header and that cells of mapped rows
+    do not span into tail rows. Special cells of all rows are counted into table.
+Returns: Most rows a cell of the first row or a mapped row spans over, 0 if records are not valid
+*/
+static size_t validate_rows(const char *data, const struct SnapshotHeader *header, Table *table)
+{
+    const char *record = data + sizeof(*header);
+    const char *end = data + header->metrics_offset;
+    size_t max_span_y = 1;
+    size_t reach = 0;
+    for (size_t i = 0; i < header->num_rows; i++)
+    {
+        if (i == 1 && record != data + header->mapped_offset) return 0;
+        if (i == header->num_mapped + 1)
+        {
+            if (record != data + header->tail_offset) return 0;
+            if (header->num_mapped > 0 && (reach > i || max_span_y > MAX_MAPPED_SPAN_Y)) return 0;
+        }
+
+        struct RecordShape shape;
+        record = validate_row(record, end, &shape);
+        if (record == NULL) return 0;
+        if (i <= header->num_mapped)
+        {
+            max_span_y = MAX(max_span_y, shape.max_span_y);
+            reach = MAX(reach, i + shape.max_span_y);
+        }
+        table->num_spanning_cells += shape.num_spanning_cells;
+        table->num_multiline_cells += shape.num_multiline_cells;
+        table->num_border_overrides += shape.num_border_overrides;
+    }
+    return record == end ? max_span_y : 0;
+}
+
+static bool read_spans(const char **data, size_t count, size_t limit, Vector *out_spans)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        struct SnapshotSpan span;
+        memcpy(&span, *data, sizeof(span));
+        *data += sizeof(span);
+        if (span.from_index >= span.to_index || span.to_index > limit) return false;
+        VEC_PUSH_ELEM(out_spans, struct SpanSize, ((struct SpanSize){
+            .from_index = span.from_index,
+            .to_index   = span.to_index,
+            .size       = span.size
+        }));
+    }
+    return true;
+}
+
+/*
+Summary: Reads metrics of mapped rows into spill, their rows are at data + mapped_offset.
+Returns: False if metrics are not valid
+*/
+static bool read_metrics(const char *data, const struct SnapshotHeader *header, struct Spill *spill)
+{
+    const char *metrics_data = data + header->metrics_offset;
+    size_t length = header->file_length - header->metrics_offset;
+    struct SnapshotMetrics metrics;
+    if (length < sizeof(metrics)) return false;
+    memcpy(&metrics, metrics_data, sizeof(metrics));
+    metrics_data += sizeof(metrics);
+
+    // Counts are checked against the length one by one, so their sum can not overflow
+    size_t left = (length - sizeof(metrics)) / sizeof(uint64_t);
+    if (metrics.num_span_widths > left / 3) return false;
+    left -= metrics.num_span_widths * 3;
+    if (metrics.num_span_heights > left / 3) return false;
+    left -= metrics.num_span_heights * 3;
+    if (left != header->num_mapped || (length - sizeof(metrics)) % sizeof(uint64_t) != 0) return false;
+
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++) spill->col_widths[i] = metrics.col_widths[i];
+    if (!read_spans(&metrics_data, metrics.num_span_widths, header->num_cols, &spill->span_widths)) return false;
+    if (!read_spans(&metrics_data, metrics.num_span_heights, header->num_mapped + 1, &spill->span_heights)) return false;
+    for (size_t i = 0; i < header->num_mapped; i++)
+    {
+        uint64_t height;
+        memcpy(&height, metrics_data + i * sizeof(height), sizeof(height));
+        VEC_PUSH_ELEM(&spill->row_heights, size_t, height);
+    }
+    spill->num_rows = header->num_mapped;
+    spill->data = data + header->mapped_offset;
+    spill->data_length = header->tail_offset - header->mapped_offset;
+    spill->file_length = spill->data_length;
+    return true;
+}
+
+/*
+Summary: Measures the cells of the mapped rows that span a single col with the limits of the loaded cols.
+    Widths of cols are taken from the file to spare measuring when loading, so they have to match.
+Returns: False if the widths in the file differ
+*/
+static bool has_valid_col_widths(const Table *table)
+{
+    const struct Spill *spill = table->spill;
+    size_t widths[TABLE_MAX_COLS] = { 0 };
+    const char *record = spill->data;
+    struct Row row;
+    for (size_t i = 0; i < spill->num_rows; i++)
+    {
+        record = decode_row(record, &row);
+        for (size_t j = 0; j < TABLE_MAX_COLS; j++)
+        {
+            const struct Cell *cell = &row.cells[j];
+            if (!cell->is_set || cell->span_x > 1) continue;
+            size_t width;
+            size_t height;
+            get_cell_size(table, cell, &width, &height);
+            widths[j] = MAX(widths[j], width);
+        }
+    }
+    return memcmp(widths, spill->col_widths, sizeof(widths)) == 0;
+}
+
+static void apply_header(Table *table, const struct SnapshotHeader *header)
+{
+    table->compact_mode = header->compact_mode;
+    table->num_rows = header->num_rows;
+    table->num_cols = header->num_cols;
+    table->num_content_cols = header->num_content_cols;
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct SnapshotCol *col = &header->cols[i];
+        table->max_widths[i] = col->max_width;
+        table->max_lines[i] = col->max_lines;
+        table->fixed_widths[i] = col->fixed_width;
+        table->border_left_counters[i] = col->border_left_counter;
+        table->attrs[i] = col->attr;
+        table->borders_left[i] = col->border_left;
+        table->h_aligns[i] = col->h_align;
+        table->v_aligns[i] = col->v_align;
+        table->overflows[i] = col->overflow;
+    }
+    for (size_t i = 0; i < NUM_GLYPHS; i++)
+    {
+        memcpy(table->glyphs.single_border[i].bytes, header->single_border[i].bytes, 4);
+        table->glyphs.single_border[i].length = header->single_border[i].length;
+        memcpy(table->glyphs.double_border[i].bytes, header->double_border[i].bytes, 4);
+        table->glyphs.double_border[i].length = header->double_border[i].length;
+    }
+    update_ellipsis(&table->glyphs);
+}
+
+// Decodes first and tail rows, texts stay in the mapping
+static void decode_resident_rows(Table *table, const char *data, const struct SnapshotHeader *header)
+{
+    decode_row(data + sizeof(*header), table->first_row);
+    const char *record = data + header->tail_offset;
+    struct Row *row = table->first_row;
+    for (size_t i = header->num_mapped + 1; i < header->num_rows; i++)
+    {
+        row->next_row = malloc_row(table);
+        row = row->next_row;
+        record = decode_row(record, row);
+        table->resident_bytes += sizeof(struct Row);
+    }
+    table->last_row = row;
+}
+
+/*
+Summary: Loads a table saved by table_save. The file is mapped, validated and printed from the mapping,
+    only the first row and the last rows are decoded. The cursor is at the beginning of the last row.
+    Rows in between can not be moved to, sorted or shown in views, like spilled rows.
+Returns: NULL if file could not be mapped or is not a valid snapshot of this version
+*/
+Table *table_load_mapped(const char *path)
+{
+    return table_load_mapped_with_allocator(path, &DEFAULT_ALLOCATOR);
+}
+
+// Like table_load_mapped, but all memory of the table is obtained from allocator
+Table *table_load_mapped_with_allocator(const char *path, const Allocator *allocator)
+{
+    assert(path != NULL);
+    assert(allocator != NULL);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(struct SnapshotHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t length = info.st_size;
+    char *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    Table *table = get_empty_table_with_allocator(allocator);
+    VEC_PUSH_ELEM(&table->mappings, struct Mapping, ((struct Mapping){ .address = data, .length = length }));
+    struct SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    size_t max_span_y = is_valid_header(&header, length) ? validate_rows(data, &header, table) : 0;
+    if (max_span_y == 0)
+    {
+        free_table(table);
+        return NULL;
+    }
+
+    if (header.num_mapped > 0)
+    {
+        table->spill = create_spill(table, NULL);
+        table->spill->max_span_y = max_span_y;
+        if (!read_metrics(data, &header, table->spill))
+        {
+            free_table(table);
+            return NULL;
+        }
+        posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+    }
+    apply_header(table, &header);
+    if (table->spill != NULL && !has_valid_col_widths(table))
+    {
+        free_table(table);
+        return NULL;
+    }
+    decode_resident_rows(table, data, &header);
+    // Fixed widths grow to the decoded cells like to added ones
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        if (table->fixed_widths[i] != 0) set_fixed_width(table, i, table->fixed_widths[i]);
+    }
+    set_position(table, 0, header.num_rows - 1);
+    return table;
+}
@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "string_util.h"
+#include "table_internal.h"
+
+/*
+ * Rows are sorted by sorting an array of small entries (row pointer and parsed key) and relinking the rows afterwards.
+ * Cells are never copied or moved.
+ */
+
+// Below this count, entries are sorted by insertion
+#define INSERTION_SORT_MAX 16
+// Halves of at least this count are sorted in their own thread
+#define PARALLEL_SORT_MIN 16384
+// At most 2^depth threads sort at once
+#define PARALLEL_SORT_DEPTH 2
+
+struct SortEntry
+{
+    struct Row *row;
+    const char *key;  // Displayed text without color codes and surrounding spaces
+    size_t key_length;
+    bool key_needs_free;
+    bool is_number;   // Only for SORT_NUMERIC
+    double number;
+};
+
+struct SortContext
+{
+    TableSortKey sort_key;
+    TableCellComparator comparator;
+};
+
+struct SortTask
+{
+    const struct SortContext *context;
+    struct SortEntry *entries;
+    struct SortEntry *scratch; // Same count as entries
+    size_t count;
+    int depth;                 // Remaining levels that may sort in parallel
+};
+
+static int compare_bytes(const char *a, size_t a_length, const char *b, size_t b_length)
+{
+    int res = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (res != 0) return res;
+    return (a_length > b_length) - (a_length < b_length);
+}
+
+static int compare_entries(const struct SortContext *context, const struct SortEntry *a, const struct SortEntry *b)
+{
+    switch (context->sort_key)
+    {
+        case SORT_NUMERIC:
+            // Numbers come first, everything else is sorted lexicographically after them
+            if (a->is_number != b->is_number) return a->is_number ? -1 : 1;
+            if (a->is_number) return (a->number > b->number) - (a->number < b->number);
+            return compare_bytes(a->key, a->key_length, b->key, b->key_length);
+        case SORT_LEXICOGRAPHIC:
+            return compare_bytes(a->key, a->key_length, b->key, b->key_length);
+        case SORT_CUSTOM:
+            return context->comparator(a->key, a->key_length, b->key, b->key_length);
+    }
+    return 0;
+}
+
+// Returns: Length of text without color codes, which is written to out_text
+static size_t strip_escapes(const char *text, size_t length, char *out_text)
+{
+    const char *end = text + length;
+    size_t res = 0;
+    while (text < end)
+    {
+        if (*text == '\033')
+        {
+            text = skip_ansi_bounded(text, end);
+            continue;
+        }
+        out_text[res++] = *text++;
+    }
+    return res;
+}
+
+// Spaces around text and color codes are not part of the key
+static void parse_key(const Table *table, const struct Cell *cell, TableSortKey sort_key, struct SortEntry *entry)
+{
+    entry->key = "";
+    entry->key_length = 0;
+    entry->key_needs_free = false;
+    entry->is_number = false;
+    if (!cell->is_set || cell->text == NULL) return;
+
+    const char *text = cell->text;
+    size_t length = cell->text_length;
+    if (cell->has_escapes)
+    {
+        char *stripped = table_alloc(table, cell->text_length);
+        length = strip_escapes(cell->text, cell->text_length, stripped);
+        text = stripped;
+        entry->key_needs_free = true;
+    }
+
+    size_t start = 0;
+    while (start < length && is_space(text[start])) start++;
+    while (length > start && is_space(text[length - 1])) length--;
+    // Stripped key is freed via entry->key, so it has to stay at the start of its allocation
+    if (entry->key_needs_free) memmove((char*)text, text + start, length - start);
+    else text += start;
+    entry->key = text;
+    entry->key_length = length - start;
+
+    entry->is_number = sort_key == SORT_NUMERIC && parse_number(entry->key, entry->key_length, &entry->number);
+}
+
+static void insertion_sort(const struct SortContext *context, struct SortEntry *entries, size_t count)
+{
+    for (size_t i = 1; i < count; i++)
+    {
+        struct SortEntry entry = entries[i];
+        size_t j = i;
+        while (j > 0 && compare_entries(context, &entries[j - 1], &entry) > 0)
+        {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+        entries[j] = entry;
+    }
+}
+
+static void *merge_sort(void *arg)
+{
+    struct SortTask *task = arg;
+    if (task->count <= INSERTION_SORT_MAX)
+    {
+        insertion_sort(task->context, task->entries, task->count);
+        return NULL;
+    }
+
+    size_t half = task->count / 2;
+    struct SortTask left = {
+        task->context, task->entries, task->scratch, half, task->depth - 1
+    };
+    struct SortTask right = {
+        task->context, task->entries + half, task->scratch + half, task->count - half, task->depth - 1
+    };
+
+    pthread_t thread;
+    bool parallel = task->depth > 0 && half >= PARALLEL_SORT_MIN
+        && pthread_create(&thread, NULL, merge_sort, &left) == 0;
+    if (!parallel) merge_sort(&left);
+    merge_sort(&right);
+    if (parallel) pthread_join(thread, NULL);
+
+    // Stable merge: On equal keys, entries of left half come first
+    size_t i = 0, j = half, k = 0;
+    while (i < half && j < task->count)
+    {
+        if (compare_entries(task->context, &task->entries[j], &task->entries[i]) < 0)
+        {
+            task->scratch[k++] = task->entries[j++];
+        }
+        else
+        {
+            task->scratch[k++] = task->entries[i++];
+        }
+    }
+    while (i < half) task->scratch[k++] = task->entries[i++];
+    while (j < task->count) task->scratch[k++] = task->entries[j++];
+    memcpy(task->entries, task->scratch, task->count * sizeof(struct SortEntry));
+    return NULL;
+}
+
+/*
+Summary: Rows that are part of a cell spanning over several rows keep their position, spans has to be at row.
+    So do rows without set cells, e.g. the row next_row moved the cursor to, which holds the bottom border of a box.
+*/
+static bool is_pinned(const Table *table, const struct SpanSweep *spans, const struct Row *row)
+{
+    bool is_empty = true;
+    for (size_t i = 0; i < table->num_cols; i++)
+    {
+        const struct Cell *parent = spans->covering[i];
+        if (parent != NULL && (parent->span_y > 1 || parent != &row->cells[parent->x])) return true;
+        if (row->cells[i].is_set) is_empty = false;
+    }
+    return is_empty;
+}
+
+/*
+Summary: Sorts rows from_row (inclusive) to to_row (exclusive) stably by their text in col.
+    Keys are compared without surrounding spaces and color codes. SORT_NUMERIC puts numbers in ascending order
+    before all other texts, SORT_CUSTOM uses comparator. Rows that belong to cells spanning over several rows
+    and empty rows are not moved, exclude header rows with from_row. Hlines stay where they are. Rows must not be published concurrently.
+    Tables with spilled rows can not be sorted.
+*/
+void table_sort_rows(Table *table, size_t col, TableSortKey sort_key, TableCellComparator comparator,
+    size_t from_row, size_t to_row)
+{
+    assert(table != NULL);
+    assert(col < TABLE_MAX_COLS);
+    assert(sort_key != SORT_CUSTOM || comparator != NULL);
+    assert(get_num_spilled(table) == 0);
+    if (to_row > table->num_rows) to_row = table->num_rows;
+    if (from_row + 1 >= to_row) return;
+
+    size_t num_slots = to_row - from_row;
+    struct Row **slots = table_alloc(table, num_slots * sizeof(struct Row*));
+    struct SortEntry *entries = table_alloc(table, num_slots * sizeof(struct SortEntry));
+    struct SortEntry *scratch = table_alloc(table, num_slots * sizeof(struct SortEntry));
+    // Hlines stay between the same slots, only cells move
+    TableBorderStyle *borders = table_alloc(table, num_slots * sizeof(TableBorderStyle));
+
+    // Collect rows in range, pinned ones stay in their slot
+    struct SpanSweep spans;
+    init_spans(&spans);
+    struct Row *before = NULL;
+    struct Row *row = table->first_row;
+    for (size_t i = 0; i < from_row; i++)
+    {
+        advance_spans(&spans, row);
+        before = row;
+        row = row->next_row;
+    }
+    size_t num_entries = 0;
+    for (size_t i = 0; i < num_slots; i++)
+    {
+        advance_spans(&spans, row);
+        borders[i] = row->border_above;
+        if (is_pinned(table, &spans, row))
+        {
+            slots[i] = row;
+        }
+        else
+        {
+            slots[i] = NULL;
+            entries[num_entries].row = row;
+            const struct Cell *parent = get_spanning_cell(&spans, row, col);
+            parse_key(table, parent != NULL ? parent : &row->cells[col], sort_key, &entries[num_entries]);
+            num_entries++;
+        }
+        row = row->next_row;
+    }
+    struct Row *after = row;
+
+    struct SortContext context = { sort_key, comparator };
+    struct SortTask task = { &context, entries, scratch, num_entries, PARALLEL_SORT_DEPTH };
+    merge_sort(&task);
+
+    // Relink rows in new order
+    size_t next_entry = 0;
+    for (size_t i = 0; i < num_slots; i++)
+    {
+        if (slots[i] == NULL) slots[i] = entries[next_entry++].row;
+        // The counter of hlines of a row includes its own one
+        slots[i]->border_above_counter += (borders[i] != BORDER_NONE) - (slots[i]->border_above != BORDER_NONE);
+        slots[i]->border_above = borders[i];
+        if (i == 0)
+        {
+            if (before == NULL) table->first_row = slots[i];
+            else before->next_row = slots[i];
+        }
+        else
+        {
+            slots[i - 1]->next_row = slots[i];
+        }
+    }
+    slots[num_slots - 1]->next_row = after;
+    if (after == NULL) table->last_row = slots[num_slots - 1];
+    reset_cursor_spans(table);
+    table->version++;
+
+    for (size_t i = 0; i < num_entries; i++)
+    {
+        if (entries[i].key_needs_free) table_free(table, (char*)entries[i].key);
+    }
+    table_free(table, slots);
+    table_free(table, entries);
+    table_free(table, scratch);
+    table_free(table, borders);
+}
@@ -0,0 +1,536 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "table_internal.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Smallest address space reserved for the mapping of a spill file
+#define MIN_RESERVATION (16 * 1024 * 1024)
+// Most bytes spilled below the budget, so rows are written and mapped in batches
+#define MAX_SPILL_SLACK (64 * 1024)
+
+/*
+ * Completed rows are moved out of memory into an unlinked temporary file, one record per row:
+ * a SpilledRow, followed by a SpilledCell and the text bytes of every cell that differs from a fresh cell.
+ * Records are stored in byte order of the host, snapshot files mark it in their header.
+ * Widths and heights of spilled rows stay in memory, so the layout is computed without reading the file.
+ * The file is mapped into a reservation of address space as rows are spilled, each time only its new end.
+ * Texts of frozen plans point into the mapping, so a reservation is never moved, only replaced by a larger one.
+ */
+
+// Records are copied out with memcpy, fields are laid out without padding
+struct SpilledRow
+{
+    uint32_t num_cells;
+    int32_t border_above_counter;
+    uint8_t border_above;
+    uint8_t unused[3];
+};
+
+enum SpilledCellFlags
+{
+    SPILLED_IS_SET                = 1 << 0,
+    SPILLED_HAS_TEXT              = 1 << 1, // Text is not NULL
+    SPILLED_HAS_ESCAPES           = 1 << 2,
+    SPILLED_OVERRIDE_H_ALIGN      = 1 << 3,
+    SPILLED_OVERRIDE_V_ALIGN      = 1 << 4,
+    SPILLED_OVERRIDE_BORDER_LEFT  = 1 << 5,
+    SPILLED_OVERRIDE_BORDER_ABOVE = 1 << 6,
+    SPILLED_OVERRIDE_ATTR         = 1 << 7
+};
+
+struct SpilledCell
+{
+    uint32_t text_length;
+    uint32_t text_height;
+    uint32_t text_width;
+    uint32_t span_y;
+    uint16_t attr;
+    uint8_t x;
+    uint8_t span_x;
+    uint8_t h_align;
+    uint8_t v_align;
+    uint8_t border_left;
+    uint8_t border_above;
+    uint8_t flags;
+    uint8_t unused[3];
+};
+
+/*
+ * Cells spanning over rows are printed from the row they begin in, so it has to be at hand until the span ends.
+ * Rows are kept in a ring that holds the rows spans reach back to and the rows they reach forward to.
+ */
+struct SpillReader
+{
+    Table *table;
+    const char *data;
+    size_t length;
+    size_t offset;      // Offset of record of row next_index
+    size_t next_index;  // Row that is decoded next
+    size_t num_slots;   // Size of ring
+    struct Row *rows;   // Last decoded rows, row i is kept in rows[i % num_slots]
+    size_t *indices;    // Index of row in rows, SIZE_MAX if none
+};
+
+/*
+Summary: Moves rows that are complete out of memory whenever the table holds more than budget bytes of rows
+    and texts it owns. Rows can be printed and exported as before, they are streamed back from the file.
+Returns: False if the temporary file could not be created, nothing is spilled then
+*/
+bool set_memory_budget(Table *table, size_t budget)
+{
+    assert(table != NULL);
+    assert(table->row_capacity == 0);
+    if (table->spill == NULL)
+    {
+        FILE *file = tmpfile();
+        if (file == NULL) return false;
+        table->spill = create_spill(table, file);
+    }
+    // Rows of a snapshot are in its mapping, further rows can not be added to it
+    if (table->spill->file == NULL) return false;
+
+    table->spill->budget = budget;
+    if (table->resident_bytes > budget) spill_rows(table);
+    return true;
+}
+
+size_t get_num_spilled(const Table *table)
+{
+    return table->spill != NULL ? table->spill->num_rows : 0;
+}
+
+// Without rows, file is NULL when metrics are collected for a snapshot
+struct Spill *create_spill(const Table *table, FILE *file)
+{
+    struct Spill *spill = table_alloc(table, sizeof(struct Spill));
+    *spill = (struct Spill){
+        .file            = file,
+        .budget          = SIZE_MAX,
+        .num_rows        = 0,
+        .file_length     = 0,
+        .data            = NULL,
+        .data_length     = 0,
+        .reserved_length = 0,
+        .max_span_y      = 1,
+        .col_widths      = { 0 },
+        .span_widths     = vec_create_with_allocator(sizeof(struct SpanSize), 16, &table->allocator),
+        .span_heights    = vec_create_with_allocator(sizeof(struct SpanSize), 16, &table->allocator),
+        .row_heights     = vec_create_with_allocator(sizeof(size_t), 256, &table->allocator),
+        .record          = vec_create_with_allocator(sizeof(char), 256, &table->allocator)
+    };
+    return spill;
+}
+
+static bool has_settings(const struct Cell *cell)
+{
+    return cell->is_set || cell->span_x > 1 || cell->override_h_align || cell->override_v_align
+        || cell->override_border_left || cell->override_border_above || cell->override_attr;
+}
+
+/*
+Summary: Rows are spilled in order and cells spanning over several rows are never spilled,
+    so their heights are known when they are spilled. Nested tables stay in memory. spans has to be at row.
+*/
+static bool can_spill(const struct SpanSweep *spans, const struct Row *row)
+{
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct Cell *cell = spans->covering[i];
+        if (cell != NULL && (cell != &row->cells[cell->x] || cell->span_y > 1)) return false;
+        if (row->cells[i].text_length > UINT32_MAX || row->cells[i].nested != NULL) return false;
+    }
+    return true;
+}
+
+void encode_row(Vector *record, const struct Row *row)
+{
+    vec_clear(record);
+    struct SpilledRow header = {
+        .num_cells            = 0,
+        .border_above_counter = row->border_above_counter,
+        .border_above         = row->border_above
+    };
+    vec_push_many(record, sizeof(header), &header);
+
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct Cell *cell = &row->cells[i];
+        if (!has_settings(cell)) continue;
+        header.num_cells++;
+
+        struct SpilledCell spilled = {
+            .text_length  = cell->text_length,
+            .text_height  = cell->text_height,
+            .text_width   = cell->text_width,
+            .span_y       = cell->span_y,
+            .attr         = cell->attr,
+            .x            = cell->x,
+            .span_x       = cell->span_x,
+            .h_align      = cell->h_align,
+            .v_align      = cell->v_align,
+            .border_left  = cell->border_left,
+            .border_above = cell->border_above,
+            .flags        = (cell->is_set ? SPILLED_IS_SET : 0)
+                | (cell->text != NULL ? SPILLED_HAS_TEXT : 0)
+                | (cell->has_escapes ? SPILLED_HAS_ESCAPES : 0)
+                | (cell->override_h_align ? SPILLED_OVERRIDE_H_ALIGN : 0)
+                | (cell->override_v_align ? SPILLED_OVERRIDE_V_ALIGN : 0)
+                | (cell->override_border_left ? SPILLED_OVERRIDE_BORDER_LEFT : 0)
+                | (cell->override_border_above ? SPILLED_OVERRIDE_BORDER_ABOVE : 0)
+                | (cell->override_attr ? SPILLED_OVERRIDE_ATTR : 0)
+        };
+        vec_push_many(record, sizeof(spilled), &spilled);
+        if (cell->text != NULL) vec_push_many(record, cell->text_length, cell->text);
+    }
+    memcpy(record->buffer, &header, sizeof(header));
+}
+
+/*
+Summary: Keeps what the layout needs to know about row with index row_index in render,
+    i.e. the constraints get_dimensions would build for it. Heights of cells spanning over several rows
+    are not weakened by hlines, which are only known once the rows they span over follow.
+*/
+void add_row_metrics(const Table *table, struct Spill *metrics, const struct Row *row, size_t row_index)
+{
+    size_t row_height = 0;
+    for (size_t i = 0; i < TABLE_MAX_COLS; i++)
+    {
+        const struct Cell *cell = &row->cells[i];
+        if (!cell->is_set) continue;
+
+        size_t width;
+        size_t height;
+        get_cell_size(table, cell, &width, &height);
+        if (cell->span_y == 1)
+        {
+            row_height = MAX(row_height, height);
+        }
+        else
+        {
+            VEC_PUSH_ELEM(&metrics->span_heights, struct SpanSize, ((struct SpanSize){
+                .from_index = row_index,
+                .to_index   = row_index + cell->span_y,
+                .size       = height
+            }));
+        }
+        if (cell->span_x == 1)
+        {
+            metrics->col_widths[i] = MAX(metrics->col_widths[i], width);
+        }
+        else
+        {
+            VEC_PUSH_ELEM(&metrics->span_widths, struct SpanSize, ((struct SpanSize){
+                .from_index = i,
+                .to_index   = i + cell->span_x,
+                .size       = width
+            }));
+        }
+    }
+    VEC_PUSH_ELEM(&metrics->row_heights, size_t, row_height);
+}
+
+static size_t get_resident_size(const Table *table, const struct Row *row)
+{
+    size_t size = sizeof(struct Row);
+    for (size_t i = 0; i < table->num_cols; i++)
+    {
+        if (row->cells[i].text_needs_free) size += row->cells[i].text_length;
+    }
+    return size;
+}
+
+/*
+Summary: Maps the first length bytes of the file. Only bytes following the mapped ones are mapped,
+    into the reservation or, if they do not fit into it, into a larger one the whole file is mapped into.
+    Earlier reservations stay mapped until free_table, texts of frozen plans may point into them.
+Returns: False if the file could not be mapped, the previous mapping is kept then
+*/
+static bool map_spill(Table *table, size_t length)
+{
+    struct Spill *spill = table->spill;
+    if (fflush(spill->file) != 0) return false;
+    int fd = fileno(spill->file);
+    size_t page_size = sysconf(_SC_PAGESIZE);
+
+    char *data = (char*)spill->data;
+    size_t mapped_length = spill->data_length;
+    size_t reserved_length = spill->reserved_length;
+    if (length > reserved_length)
+    {
+        // Address space is reserved by mapping the file without access, its pages beyond the end are never touched
+        reserved_length = (MAX(2 * length, MIN_RESERVATION) + page_size - 1) / page_size * page_size;
+        data = mmap(NULL, reserved_length, PROT_NONE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) return false;
+        mapped_length = 0;
+    }
+
+    // The last page mapped so far may have been partial, it is mapped again with the bytes that follow
+    size_t offset = mapped_length / page_size * page_size;
+    if (mmap(data + offset, length - offset, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, offset) == MAP_FAILED)
+    {
+        if (data != spill->data) munmap(data, reserved_length);
+        return false;
+    }
+    posix_madvise(data + offset, length - offset, POSIX_MADV_SEQUENTIAL);
+    if (data != spill->data)
+    {
+        VEC_PUSH_ELEM(&table->mappings, struct Mapping, ((struct Mapping){ .address = data, .length = reserved_length }));
+        spill->data = data;
+        spill->reserved_length = reserved_length;
+    }
+    spill->data_length = length;
+    return true;
+}
+
+/*
+Summary: Spills rows following the first row until the table fits into its budget again, with some room to spare.
+    Stops at the cursor row and at rows that cells span into or out of, they stay in memory.
+    Rows are only removed once their records are mapped, so printing never misses a spilled row.
+    If the file can not be written or mapped, the rows stay in memory.
+*/
+void spill_rows(Table *table)
+{
+    struct Spill *spill = table->spill;
+    // Rows published concurrently are linked by other threads
+    if (spill->file == NULL || __atomic_load_n(&table->publish_mode, __ATOMIC_RELAXED) != 0) return;
+
+    struct Row *head = table->first_row;
+    struct Row *last = head; // Last row written to file
+    size_t file_length = spill->file_length;
+    size_t resident_bytes = table->resident_bytes;
+    size_t target = spill->budget - MIN(spill->budget / 2, MAX_SPILL_SLACK);
+    struct SpanSweep spans;
+    init_spans(&spans);
+    advance_spans(&spans, head);
+    while (resident_bytes > target)
+    {
+        struct Row *row = last->next_row;
+        if (row == NULL || row == table->curr_row) break;
+        advance_spans(&spans, row);
+        if (!can_spill(&spans, row)) break;
+
+        encode_row(&spill->record, row);
+        size_t length = vec_count(&spill->record);
+        if (fwrite(spill->record.buffer, 1, length, spill->file) != length)
+        {
+            // Rest of a partially written record is never read, the next record overwrites it
+            clearerr(spill->file);
+            fseek(spill->file, file_length, SEEK_SET);
+            break;
+        }
+        file_length += length;
+        resident_bytes -= get_resident_size(table, row);
+        last = row;
+    }
+    if (last == head) return;
+    if (!map_spill(table, file_length))
+    {
+        // Records of the rows are overwritten by the next ones
+        clearerr(spill->file);
+        fseek(spill->file, spill->file_length, SEEK_SET);
+        return;
+    }
+
+    struct Row *end = last->next_row;
+    while (head->next_row != end)
+    {
+        struct Row *row = head->next_row;
+        spill->num_rows++;
+        add_row_metrics(table, spill, row, spill->num_rows);
+        head->next_row = row->next_row;
+        table->resident_bytes -= get_resident_size(table, row);
+        retire_row(table, row);
+    }
+    spill->file_length = file_length;
+}
+
+/*
+Summary: Reads spilled rows from the mapping of the file, which covers all of them.
+Returns: NULL if no row is spilled
+*/
+struct SpillReader *open_spill_reader(Table *table)
+{
+    struct Spill *spill = table->spill;
+    if (get_num_spilled(table) == 0) return NULL;
+
+    // A span is printed from the row it begins in, while rows it reaches to are read for its height
+    struct SpillReader *reader = table_alloc(table, sizeof(struct SpillReader));
+    reader->table = table;
+    reader->data = spill->data;
+    reader->length = spill->data_length;
+    reader->offset = 0;
+    reader->next_index = 0;
+    reader->num_slots = 2 * spill->max_span_y + 1;
+    reader->rows = table_alloc(table, reader->num_slots * sizeof(struct Row));
+    reader->indices = table_alloc(table, reader->num_slots * sizeof(size_t));
+    for (size_t i = 0; i < reader->num_slots; i++) reader->indices[i] = SIZE_MAX;
+    return reader;
+}
+
+/*
+Summary: Decodes record into row, texts are not copied and point into the record.
+Returns: Start of next record
+*/
+const char *decode_row(const char *record, struct Row *row)
+{
+    struct SpilledRow header;
+    memcpy(&header, record, sizeof(header));
+    record += sizeof(header);
+
+    init_row(row);
+    row->border_above = header.border_above;
+    row->border_above_counter = header.border_above_counter;
+    for (size_t i = 0; i < header.num_cells; i++)
+    {
+        struct SpilledCell spilled;
+        memcpy(&spilled, record, sizeof(spilled));
+        record += sizeof(spilled);
+
+        struct Cell *cell = &row->cells[spilled.x];
+        *cell = (struct Cell){
+            .text                  = NULL,
+            .text_length           = spilled.text_length,
+            .text_height           = spilled.text_height,
+            .text_width            = spilled.text_width,
+            .h_align               = spilled.h_align,
+            .v_align               = spilled.v_align,
+            .border_left           = spilled.border_left,
+            .border_above          = spilled.border_above,
+            .span_x                = spilled.span_x,
+            .span_y                = spilled.span_y,
+            .attr                  = spilled.attr,
+            .override_v_align      = spilled.flags & SPILLED_OVERRIDE_V_ALIGN,
+            .override_h_align      = spilled.flags & SPILLED_OVERRIDE_H_ALIGN,
+            .override_border_left  = spilled.flags & SPILLED_OVERRIDE_BORDER_LEFT,
+            .override_border_above = spilled.flags & SPILLED_OVERRIDE_BORDER_ABOVE,
+            .override_attr         = spilled.flags & SPILLED_OVERRIDE_ATTR,
+            .has_escapes           = spilled.flags & SPILLED_HAS_ESCAPES,
+            .is_set                = spilled.flags & SPILLED_IS_SET,
+            .text_needs_free       = false,
+            .x                     = spilled.x
+        };
+        if (spilled.flags & SPILLED_HAS_TEXT)
+        {
+            cell->text = (char*)record;
+            record += spilled.text_length;
+        }
+    }
+    return record;
+}
+
+static bool is_valid_cell(const struct SpilledCell *cell)
+{
+    return cell->x < TABLE_MAX_COLS
+        && cell->span_x >= 1 && cell->x + cell->span_x <= TABLE_MAX_COLS
+        && cell->span_y >= 1
+        && cell->h_align <= H_ALIGN_CENTER && cell->v_align <= V_ALIGN_CENTER
+        && cell->border_left <= BORDER_DOUBLE && cell->border_above <= BORDER_DOUBLE
+        && is_valid_attr(cell->attr)
+        && ((cell->flags & SPILLED_HAS_TEXT) || cell->text_length == 0)
+        && cell->text_width <= cell->text_length
+        && cell->text_height <= (uint64_t)cell->text_length + 1;
+}
+
+/*
+Summary: Checks that record is a well-formed row that ends before end, so decode_row stays within bounds.
+    Texts are not measured again, their metrics are only checked to be possible for their length.
+Returns: Start of next record, NULL if record is not valid. Spans and special cells of it in out_shape.
+*/
+const char *validate_row(const char *record, const char *end, struct RecordShape *out_shape)
+{
+    struct SpilledRow header;
+    if ((size_t)(end - record) < sizeof(header)) return NULL;
+    memcpy(&header, record, sizeof(header));
+    record += sizeof(header);
+    if (header.num_cells > TABLE_MAX_COLS || header.border_above > BORDER_DOUBLE) return NULL;
+
+    *out_shape = (struct RecordShape){ .max_span_y = 1 };
+    size_t next_x = 0;
+    for (size_t i = 0; i < header.num_cells; i++)
+    {
+        struct SpilledCell cell;
+        if ((size_t)(end - record) < sizeof(cell)) return NULL;
+        memcpy(&cell, record, sizeof(cell));
+        record += sizeof(cell);
+        if (!is_valid_cell(&cell) || cell.x < next_x) return NULL;
+        if (cell.flags & SPILLED_HAS_TEXT)
+        {
+            if ((size_t)(end - record) < cell.text_length) return NULL;
+            record += cell.text_length;
+        }
+        next_x = cell.x + 1;
+        out_shape->max_span_y = MAX(out_shape->max_span_y, cell.span_y);
+        out_shape->num_spanning_cells += cell.span_x > 1 || cell.span_y > 1;
+        out_shape->num_multiline_cells += cell.text_height > 1;
+        out_shape->num_border_overrides += (cell.flags & (SPILLED_OVERRIDE_BORDER_LEFT | SPILLED_OVERRIDE_BORDER_ABOVE)) != 0;
+    }
+    return record;
+}
+
+/*
+Summary: Decodes spilled row with index. Rows are meant to be read in order,
+    reading a row before the last two read ones starts over at the beginning of the file.
+Returns: Row that stays valid until the row with index + 2 is read
+*/
+struct Row *read_spilled_row(struct SpillReader *reader, size_t index)
+{
+    assert(index < get_num_spilled(reader->table));
+    struct Row *row = &reader->rows[index % reader->num_slots];
+    if (reader->indices[index % reader->num_slots] == index) return row;
+
+    if (index < reader->next_index)
+    {
+        reader->offset = 0;
+        reader->next_index = 0;
+    }
+    while (reader->next_index <= index)
+    {
+        size_t slot = reader->next_index % reader->num_slots;
+        const char *record = reader->data + reader->offset;
+        reader->offset += decode_row(record, &reader->rows[slot]) - record;
+        reader->indices[slot] = reader->next_index;
+        reader->next_index++;
+    }
+    return row;
+}
+
+/*
+Summary: Visits rows of table in order, rows of the spill file follow the first row.
+    Spilled rows are left out without reader.
+Returns: Row with index, prev has to be the row with index - 1. NULL after the last row.
+*/
+const struct Row *get_following_row(const Table *table, struct SpillReader *reader, size_t index, const struct Row *prev)
+{
+    size_t num_spilled = reader != NULL ? get_num_spilled(table) : 0;
+    if (index == 0) return table->first_row;
+    if (index <= num_spilled) return read_spilled_row(reader, index - 1);
+    return get_next_row(index == num_spilled + 1 ? table->first_row : prev);
+}
+
+void close_spill_reader(struct SpillReader *reader)
+{
+    if (reader == NULL) return;
+    table_free(reader->table, reader->rows);
+    table_free(reader->table, reader->indices);
+    table_free(reader->table, reader);
+}
+
+// Mappings of the file are unmapped with all others by free_table
+void free_spill(const Table *table, struct Spill *spill)
+{
+    if (spill == NULL) return;
+    if (spill->file != NULL) fclose(spill->file);
+    vec_destroy(&spill->span_widths);
+    vec_destroy(&spill->span_heights);
+    vec_destroy(&spill->row_heights);
+    vec_destroy(&spill->record);
+    table_free(table, spill);
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Attribute IDs pack a TableStyle into 11 bits:
+ * Bits 0-4 foreground, bits 5-9 background, bit 10 bold.
+ */
+
+#define COLOR_MASK   0x1F
+#define BG_SHIFT  5
+#define BOLD_FLAG (1 << 10)
+
+uint16_t encode_style(TableStyle style)
+{
+    assert(style.foreground <= COLOR_BRIGHT_WHITE);
+    assert(style.background <= COLOR_BRIGHT_WHITE);
+    return style.foreground | style.background << BG_SHIFT | (style.bold ? BOLD_FLAG : 0);
+}
+
+// Checks an attribute ID read from a file, both colors have to be known and no other bits set
+bool is_valid_attr(uint16_t attr)
+{
+    return attr <= (BOLD_FLAG | COLOR_MASK << BG_SHIFT | COLOR_MASK)
+        && (attr & COLOR_MASK) <= COLOR_BRIGHT_WHITE && (attr >> BG_SHIFT & COLOR_MASK) <= COLOR_BRIGHT_WHITE;
+}
+
+// SGR parameter of color, base is 30 for foreground and 40 for background
+static int get_color_code(unsigned color, int base)
+{
+    if (color == COLOR_DEFAULT) return base + 9;
+    if (color <= COLOR_WHITE) return base + color - COLOR_BLACK;
+    return base + 60 + color - COLOR_BRIGHT_BLACK;
+}
+
+/*
+Summary: Writes the shortest SGR sequence that switches terminal from attribute from to attribute to.
+    Only changed parts are set, a switch to ATTR_DEFAULT is a single reset.
+*/
+void out_attr_change(struct Output *out, uint16_t from, uint16_t to)
+{
+    if (from == to) return;
+    if (to == ATTR_DEFAULT)
+    {
+        out_write(out, "\033[0m", 4);
+        return;
+    }
+
+    char sequence[32] = "\033[";
+    int length = 2;
+    const char *separator = "";
+    if (from == ATTR_UNKNOWN)
+    {
+        // Nothing can be assumed, so start from a reset
+        length += snprintf(sequence + length, sizeof(sequence) - length, "0");
+        separator = ";";
+        from = ATTR_DEFAULT;
+    }
+    if ((from & BOLD_FLAG) != (to & BOLD_FLAG))
+    {
+        length += snprintf(sequence + length, sizeof(sequence) - length, "%s%d", separator, to & BOLD_FLAG ? 1 : 22);
+        separator = ";";
+    }
+    if ((from & COLOR_MASK) != (to & COLOR_MASK))
+    {
+        length += snprintf(sequence + length, sizeof(sequence) - length, "%s%d", separator, get_color_code(to & COLOR_MASK, 30));
+        separator = ";";
+    }
+    if ((from >> BG_SHIFT & COLOR_MASK) != (to >> BG_SHIFT & COLOR_MASK))
+    {
+        length += snprintf(sequence + length, sizeof(sequence) - length, "%s%d", separator, get_color_code(to >> BG_SHIFT & COLOR_MASK, 40));
+    }
+    sequence[length++] = 'm';
+    out_write(out, sequence, length);
+}
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "table_internal.h"
+
+/*
+ * Views select rows and cols of a table by index, cells are never copied.
+ * Rows are resolved when printing, so a view stays valid when rows are added to its table.
+ */
+
+struct TableView
+{
+    Table *table;
+    size_t *rows;                 // Selected row indices, all rows when NULL
+    size_t num_rows;
+    size_t cols[TABLE_MAX_COLS];  // Selected col indices, valid when num_cols != 0
+    size_t num_cols;              // All cols when 0
+};
+
+static bool is_empty_row(const Table *table, const struct Row *row)
+{
+    for (size_t i = 0; i < table->num_cols; i++)
+    {
+        if (row->cells[i].is_set) return false;
+    }
+    return true;
+}
+
+// A selected row index and its position in the selection
+struct Selection
+{
+    size_t index;
+    size_t position;
+};
+
+static int compare_selections(const void *a, const void *b)
+{
+    const struct Selection *x = a, *y = b;
+    if (x->index != y->index) return (x->index > y->index) - (x->index < y->index);
+    return (x->position > y->position) - (x->position < y->position);
+}
+
+/*
+Summary: Sorts the selected rows by index, so they can be resolved in a single walk over the rows of the table.
+    All rows of table are selected when view->rows is NULL.
+Returns: Selected rows ordered by index, number of them in out_count
+*/
+static struct Selection *sort_selection(const TableView *view, size_t *out_count)
+{
+    size_t count = view->num_rows;
+    if (view->rows == NULL)
+    {
+        count = 0;
+        for (struct Row *row = view->table->first_row; row != NULL; row = get_next_row(row)) count++;
+    }
+
+    struct Selection *selection = table_alloc(view->table, count * sizeof(struct Selection));
+    for (size_t i = 0; i < count; i++)
+    {
+        selection[i] = (struct Selection){ view->rows != NULL ? view->rows[i] : i, i };
+    }
+    if (view->rows != NULL && count > 1) qsort(selection, count, sizeof(struct Selection), compare_selections);
+    *out_count = count;
+    return selection;
+}
+
+/*
+Summary: Returns a view that shows all rows and cols of table. Must be freed before the table.
+    Views of tables with spilled rows are not supported.
+*/
+TableView *get_table_view(Table *table)
+{
+    assert(table != NULL);
+    assert(get_num_spilled(table) == 0);
+    TableView *view = table_alloc(table, sizeof(TableView));
+    *view = (TableView){ .table = table, .rows = NULL, .num_rows = 0, .num_cols = 0 };
+    return view;
+}
+
+/*
+Summary: Shows rows of table with given indices in given order. Indices beyond the table are not printed.
+*/
+void view_select_rows(TableView *view, size_t num_rows, const size_t *row_indices)
+{
+    assert(view != NULL);
+    assert(row_indices != NULL || num_rows == 0);
+    size_t *rows = table_alloc(view->table, num_rows * sizeof(size_t));
+    memcpy(rows, row_indices, num_rows * sizeof(size_t));
+    if (view->rows != NULL) table_free(view->table, view->rows);
+    view->rows = rows;
+    view->num_rows = num_rows;
+}
+
+/*
+Summary: Keeps only the shown rows for which predicate returns true. Predicate is called once per row now,
+    in order of the table, with the texts of the cells of the row (spanned cells contain the text of the spanning cell).
+*/
+void view_filter_rows(TableView *view, TableRowPredicate predicate, void *context)
+{
+    assert(view != NULL);
+    assert(predicate != NULL);
+    Table *table = view->table;
+    size_t num_candidates;
+    struct Selection *selection = sort_selection(view, &num_candidates);
+
+    // Spans are resolved by sweeping over the rows in order, candidates are met in the same order
+    bool *keep = table_alloc(table, num_candidates * sizeof(bool));
+    struct SpanSweep spans;
+    init_spans(&spans);
+    size_t next = 0;
+    struct Row *row = table->first_row;
+    for (size_t i = 0; row != NULL && next < num_candidates; i++, row = get_next_row(row))
+    {
+        advance_spans(&spans, row);
+        if (selection[next].index != i) continue;
+
+        TableText texts[TABLE_MAX_COLS];
+        for (size_t j = 0; j < table->num_cols; j++)
+        {
+            const struct Cell *cell = get_spanning_cell(&spans, row, j);
+            if (cell == NULL) cell = &row->cells[j];
+            texts[j] = (TableText){ cell->is_set ? cell->text : NULL, cell->text_length };
+        }
+        // Rows that are selected several times are tested once
+        bool res = predicate(i, texts, table->num_cols, context);
+        while (next < num_candidates && selection[next].index == i) keep[selection[next++].position] = res;
+    }
+    // Indices beyond the table are dropped
+    while (next < num_candidates) keep[selection[next++].position] = false;
+
+    size_t *rows = table_alloc(table, num_candidates * sizeof(size_t));
+    size_t num_rows = 0;
+    for (size_t i = 0; i < num_candidates; i++)
+    {
+        if (keep[i]) rows[num_rows++] = view->rows != NULL ? view->rows[i] : i;
+    }
+
+    if (view->rows != NULL) table_free(table, view->rows);
+    view->rows = rows;
+    view->num_rows = num_rows;
+    table_free(table, keep);
+    table_free(table, selection);
+}
+
+/*
+Summary: Shows cols of table with given indices in given order.
+*/
+void view_select_cols(TableView *view, size_t num_cols, const size_t *col_indices)
+{
+    assert(view != NULL);
+    assert(num_cols <= TABLE_MAX_COLS);
+    for (size_t i = 0; i < num_cols; i++)
+    {
+        assert(col_indices[i] < TABLE_MAX_COLS);
+        view->cols[i] = col_indices[i];
+    }
+    view->num_cols = num_cols;
+}
+
+/*
+Summary: Prints selected rows and cols like fprint_table, layout is computed over them only.
+    Rows and cols that only carry borders (like the ones added by make_boxed) are kept at the end.
+    Spans are ignored once rows or cols are selected, cells that are spanned over are printed empty then.
+*/
+void fprint_table_view(const TableView *view, FILE *stream)
+{
+    assert(view != NULL);
+    assert(stream != NULL);
+    Table *table = view->table;
+    TableSink sink = get_stream_sink(stream);
+    struct SinkBuffer buffer;
+    struct Output out = output_from_sink(&buffer, &sink);
+    if (view->rows == NULL && view->num_cols == 0)
+    {
+        // Nothing is selected, so spans can be kept
+        render_table(table, &out);
+        finish_sink(&buffer);
+        return;
+    }
+
+    size_t num_table_cols = __atomic_load_n(&table->num_cols, __ATOMIC_ACQUIRE);
+
+    // Selected rows, followed by last row of table when it is empty
+    size_t num_selected;
+    struct Selection *selection = sort_selection(view, &num_selected);
+    struct Row **rows = table_alloc(table, (num_selected + 1) * sizeof(struct Row*));
+    for (size_t i = 0; i < num_selected; i++) rows[i] = NULL;
+    size_t next = 0;
+    size_t index = 0;
+    struct Row *last_row = NULL;
+    for (struct Row *row = table->first_row; row != NULL; row = get_next_row(row), index++)
+    {
+        while (next < num_selected && selection[next].index == index) rows[selection[next++].position] = row;
+        last_row = row;
+    }
+    table_free(table, selection);
+
+    // Indices beyond the table are not printed
+    size_t num_rows = 0;
+    for (size_t i = 0; i < num_selected; i++)
+    {
+        if (rows[i] != NULL) rows[num_rows++] = rows[i];
+    }
+    if (is_empty_row(table, last_row) && (num_rows == 0 || rows[num_rows - 1] != last_row))
+    {
+        rows[num_rows++] = last_row;
+    }
+
+    // Selected cols, followed by cols without content
+    size_t cols[TABLE_MAX_COLS];
+    size_t num_cols = 0;
+    if (view->num_cols == 0)
+    {
+        for (size_t i = 0; i < num_table_cols; i++) cols[num_cols++] = i;
+    }
+    else
+    {
+        for (size_t i = 0; i < view->num_cols; i++) cols[num_cols++] = view->cols[i];
+        for (size_t i = table->num_content_cols; i < num_table_cols && num_cols < TABLE_MAX_COLS; i++)
+        {
+            cols[num_cols++] = i;
+        }
+    }
+
+    render_selection(table, rows, num_rows, cols, num_cols, &out);
+    finish_sink(&buffer);
+    table_free(table, rows);
+}
+
+void free_table_view(TableView *view)
+{
+    assert(view != NULL);
+    if (view->rows != NULL) table_free(view->table, view->rows);
+    table_free(view->table, view);
+}
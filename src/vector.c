@@ -11,7 +11,7 @@
 void vec_trim(Vector *vec)
 {
     vec->buffer_size = vec->elem_count + 1;
-    vec->buffer = realloc(vec->buffer, vec->elem_size * vec->buffer_size);
+    vec->buffer = vec->allocator->realloc(vec->allocator->context, vec->buffer, vec->elem_size * vec->buffer_size);
 }
 
 void vec_ensure_size(Vector *vec, size_t needed_size)
@@ -20,16 +20,22 @@ void vec_ensure_size(Vector *vec, size_t needed_size)
     {
         vec->buffer_size += MAX(1, (size_t)(vec->buffer_size * VECTOR_GROWTHFACTOR));
     }
-    vec->buffer = realloc(vec->buffer, vec->elem_size * vec->buffer_size);
+    vec->buffer = vec->allocator->realloc(vec->allocator->context, vec->buffer, vec->elem_size * vec->buffer_size);
 }
 
 Vector vec_create(size_t elem_size, size_t start_size)
+{
+    return vec_create_with_allocator(elem_size, start_size, &DEFAULT_ALLOCATOR);
+}
+
+Vector vec_create_with_allocator(size_t elem_size, size_t start_size, const Allocator *allocator)
 {
     return (Vector){
         .elem_size   = elem_size,
         .elem_count  = 0,
         .buffer_size = start_size,
-        .buffer      = malloc(elem_size * start_size)
+        .buffer      = allocator->alloc(allocator->context, elem_size * start_size),
+        .allocator   = allocator
     };
 }
 
@@ -40,7 +46,7 @@ void vec_clear(Vector *vec)
 
 void vec_destroy(Vector *vec)
 {
-    free(vec->buffer);
+    vec->allocator->free(vec->allocator->context, vec->buffer);
 }
 
 void *vec_get(const Vector *vec, size_t index)
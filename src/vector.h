@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include "allocator.h"
 
 // May change the buffer location
 #define VEC_PUSH_ELEM(vec, type, expr) ((*(type*)vec_push_empty(vec)) = (expr))
@@ -19,10 +20,12 @@ typedef struct
     size_t elem_count;
     size_t buffer_size;
     void *buffer;
+    const Allocator *allocator; // Must outlive vector
 } Vector;
 
 // Buffer handling
 Vector vec_create(size_t elem_size, size_t start_size);
+Vector vec_create_with_allocator(size_t elem_size, size_t start_size, const Allocator *allocator);
 void vec_clear(Vector *vec);
 void vec_destroy(Vector *vec);
 void vec_trim(Vector *vec);
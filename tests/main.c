@@ -4,6 +4,9 @@
 
 #include "test.h"
 #include "test_table.h"
+#include "test_csv.h"
+#include "test_export.h"
+#include "test_concurrency.h"
 #include "../src/table.h"
 #include "../src/string_builder.h"
 
@@ -11,9 +14,15 @@
 
 
 
-static const size_t NUM_TESTS = 1;
+static const TableStyle PASSED_STYLE = { COLOR_GREEN, COLOR_DEFAULT, true };
+static const TableStyle FAILED_STYLE = { COLOR_RED, COLOR_DEFAULT, true };
+
+static const size_t NUM_TESTS = 4;
 static Test (*test_getters[])() = {
     get_table_test,
+    get_csv_test,
+    get_export_test,
+    get_concurrency_test,
 };
 
 int main()
@@ -43,14 +52,16 @@ int main()
 
             if (test.suite(&error_builder))
             {
-                add_cell(table, F_GREEN " passed " COL_RESET);
+                override_style(table, PASSED_STYLE);
+                add_cell(table, " passed ");
             }
             else
             {
                 printf("[" F_RED "%s" COL_RESET "] %s",
                     test_getters[i]().name,
                     (char*)error_builder.buffer);
-                add_cell(table, F_RED " failed " COL_RESET);
+                override_style(table, FAILED_STYLE);
+                add_cell(table, " failed ");
                 error = true;
             }
             strb_clear(&error_builder);
@@ -63,7 +74,8 @@ int main()
     override_horizontal_alignment(table, H_ALIGN_CENTER);
     set_hline(table, BORDER_SINGLE);
     add_cell(table, " End result ");
-    add_cell(table, error ? F_RED " failed " COL_RESET : F_GREEN " passed " COL_RESET);
+    override_style(table, error ? FAILED_STYLE : PASSED_STYLE);
+    add_cell(table, error ? " failed " : " passed ");
     next_row(table);
     make_boxed(table, BORDER_SINGLE);
     print_table(table);
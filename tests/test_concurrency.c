@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include "test_concurrency.h"
+#include "../src/table.h"
+#include "../src/string_builder.h"
+
+#define NUM_CASES 5
+#define NUM_THREADS 4
+#define ROWS_PER_THREAD 500
+
+struct Producer
+{
+    Table *table;
+    size_t index;
+    bool ordered;
+};
+
+static void *produce_rows(void *arg)
+{
+    struct Producer *producer = arg;
+    for (size_t i = 0; i < ROWS_PER_THREAD; i++)
+    {
+        // Keys of all producers interleave, so ordered rows need to be sorted on insertion
+        size_t key = i * NUM_THREADS + producer->index;
+        TableRowBuilder *builder = get_row_builder(producer->table);
+        row_builder_add_cell_fmt(builder, "%zu", producer->index);
+        row_builder_add_cell_fmt(builder, "%zu", i);
+        row_builder_add_cell_fmt(builder, "%zu", key);
+        if (producer->ordered)
+        {
+            publish_row_ordered(builder, key);
+        }
+        else
+        {
+            publish_row(builder);
+        }
+    }
+    return NULL;
+}
+
+static void *render_repeatedly(void *arg)
+{
+    Table *table = arg;
+    size_t *num_renders = malloc(sizeof(size_t));
+    *num_renders = 0;
+    for (size_t i = 0; i < 20; i++)
+    {
+        size_t size = table_rendered_size(table);
+        char *buf = malloc(size);
+        table_render_into(table, buf, size);
+        free(buf);
+        (*num_renders)++;
+    }
+    return num_renders;
+}
+
+// Returns: Table with header row, filled by NUM_THREADS producers
+static Table *produce_table(bool ordered, bool render_concurrently)
+{
+    Table *table = get_empty_table();
+    add_cells(table, 3, "thread", "index", "key");
+    next_row(table);
+
+    pthread_t threads[NUM_THREADS];
+    struct Producer producers[NUM_THREADS];
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        producers[i] = (struct Producer){ table, i, ordered };
+        pthread_create(&threads[i], NULL, produce_rows, &producers[i]);
+    }
+
+    pthread_t renderer;
+    if (render_concurrently) pthread_create(&renderer, NULL, render_repeatedly, table);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    if (render_concurrently)
+    {
+        void *num_renders;
+        pthread_join(renderer, &num_renders);
+        free(num_renders);
+    }
+    return table;
+}
+
+/*
+Summary: Reads exported rows back, checks that every produced row is present exactly once
+    and that rows of each producer keep their order
+*/
+static bool check_rows(Vector *error_builder, Table *table, bool ordered, const char *case_name)
+{
+    char *csv = NULL;
+    size_t csv_size = 0;
+    FILE *stream = open_memstream(&csv, &csv_size);
+    fprint_table_as(table, stream, TABLE_FORMAT_CSV);
+    fclose(stream);
+
+    bool success = true;
+    size_t next_index[NUM_THREADS] = { 0 };
+    size_t num_rows = 0;
+    const char *line = strchr(csv, '\n') + 1;
+    while (*line != '\0')
+    {
+        size_t thread, index, key;
+        if (sscanf(line, "%zu,%zu,%zu", &thread, &index, &key) != 3 || thread >= NUM_THREADS
+            || index != next_index[thread] || (ordered && key != num_rows))
+        {
+            strb_append(error_builder, "%s: Unexpected row %zu: %.20s\n", case_name, num_rows, line);
+            success = false;
+            break;
+        }
+        next_index[thread]++;
+        num_rows++;
+        line = strchr(line, '\n') + 1;
+    }
+
+    if (success && num_rows != NUM_THREADS * ROWS_PER_THREAD)
+    {
+        strb_append(error_builder, "%s: Expected %d rows, got %zu.\n", case_name, NUM_THREADS * ROWS_PER_THREAD, num_rows);
+        success = false;
+    }
+    free(csv);
+    return success;
+}
+
+struct PlanPrinter
+{
+    const TablePlan *plan;
+    char *buffer;
+};
+
+static void *print_plan(void *arg)
+{
+    struct PlanPrinter *printer = arg;
+    size_t size = table_plan_size(printer->plan);
+    printer->buffer = malloc(size);
+    table_plan_render_into(printer->plan, printer->buffer, size);
+    return NULL;
+}
+
+// All threads executing the same plan need to produce the same output as the table
+static bool check_plan(Vector *error_builder, const char *case_name)
+{
+    Table *table = produce_table(false, false);
+    make_boxed(table, BORDER_SINGLE);
+    set_all_vlines(table, BORDER_SINGLE);
+    size_t size = table_rendered_size(table);
+    char *expected = malloc(size);
+    table_render_into(table, expected, size);
+
+    TablePlan *plan = table_freeze(table);
+    pthread_t threads[NUM_THREADS];
+    struct PlanPrinter printers[NUM_THREADS];
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        printers[i] = (struct PlanPrinter){ plan, NULL };
+        pthread_create(&threads[i], NULL, print_plan, &printers[i]);
+    }
+
+    bool success = table_plan_size(plan) == size;
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if (success && memcmp(printers[i].buffer, expected, size) != 0) success = false;
+        free(printers[i].buffer);
+    }
+    if (!success) strb_append(error_builder, "%s: Plan printed differently.\n", case_name);
+
+    free(expected);
+    free_table_plan(plan);
+    free_table(table);
+    return success;
+}
+
+// Status table of a service loop in the given round
+static Table *get_status_table(size_t round)
+{
+    Table *table = get_empty_table();
+    add_cells(table, 2, "round", "requests");
+    next_row(table);
+    add_cell_fmt(table, "%zu", round);
+    add_cell_fmt(table, "%zu", round * 1000);
+    next_row(table);
+    make_boxed(table, BORDER_SINGLE);
+    return table;
+}
+
+static void count_notifications(__attribute__((unused)) TableRenderer *renderer, void *context)
+{
+    __atomic_fetch_add((int*)context, 1, __ATOMIC_RELAXED);
+}
+
+// Every submitted table is rendered in the background while the next one is built
+static bool check_async(Vector *error_builder, const char *case_name)
+{
+    int notifications = 0;
+    TableRenderer *renderer = get_table_renderer(count_notifications, &notifications);
+    bool success = renderer != NULL;
+    for (size_t round = 0; round < 3 && success; round++)
+    {
+        table_renderer_submit(renderer, get_status_table(round));
+        Table *expected_table = get_status_table(round);
+        size_t size = table_rendered_size(expected_table);
+        char *expected = malloc(size);
+        table_render_into(expected_table, expected, size);
+        free_table(expected_table);
+
+        struct pollfd event = { .fd = table_renderer_fd(renderer), .events = POLLIN };
+        const char *output;
+        size_t length;
+        if (poll(&event, 1, 5000) != 1 || !table_renderer_take(renderer, &output, &length)
+            || length != size || memcmp(output, expected, size) != 0)
+        {
+            strb_append(error_builder, "%s: Output of round %zu differs.\n", case_name, round);
+            success = false;
+        }
+        free(expected);
+    }
+    // Worker has called back for the last output once it is stopped
+    if (renderer != NULL) free_table_renderer(renderer);
+    if (success && notifications != 3)
+    {
+        strb_append(error_builder, "%s: Callback was called %d times.\n", case_name, notifications);
+        success = false;
+    }
+    return success;
+}
+
+static bool check_case(Vector *error_builder, bool ordered, bool render_concurrently, const char *case_name)
+{
+    Table *table = produce_table(ordered, render_concurrently);
+    bool success = check_rows(error_builder, table, ordered, case_name);
+    free_table(table);
+    return success;
+}
+
+bool concurrency_test(Vector *error_builder)
+{
+    bool success = true;
+    // Case 1: Rows in order of arrival
+    if (!check_case(error_builder, false, false, "Case 1")) success = false;
+    // Case 2: Rows ordered by key
+    if (!check_case(error_builder, true, false, "Case 2")) success = false;
+    // Case 3: Printing while rows are published
+    if (!check_case(error_builder, false, true, "Case 3")) success = false;
+    // Case 4: Executing a frozen plan concurrently
+    if (!check_plan(error_builder, "Case 4")) success = false;
+    // Case 5: Rendering in the background
+    if (!check_async(error_builder, "Case 5")) success = false;
+    return success;
+}
+
+Test get_concurrency_test()
+{
+    return (Test){
+        concurrency_test,
+        NUM_CASES,
+        "Concurrency"
+    };
+}
@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_csv.h"
+#include "../src/table.h"
+#include "../src/string_builder.h"
+
+#define NUM_CASES 2
+
+static const char *CSV_CONTENT =
+    "name,value,comment\r\n"
+    "\"quoted, with comma\",1,\"multi\nline\"\n"
+    "\"say \"\"hi\"\"\",22,\n"
+    "plain\n";
+
+static const char *TSV_CONTENT =
+    "name\tvalue\tcomment\r\n"
+    "quoted, with comma\t1\t\"multi\nline\"\n"
+    "\"say \"\"hi\"\"\"\t22\t\n"
+    "plain";
+
+static const char *EXPECTED[4][3] = {
+    { "name", "value", "comment" },
+    { "quoted, with comma", "1", "multi\nline" },
+    { "say \"hi\"", "22", "" },
+    { "plain", NULL, NULL },
+};
+
+// Renders table into a freshly allocated, \0-terminated string
+static char *render(Table *table)
+{
+    size_t size = table_rendered_size(table);
+    char *res = malloc(size + 1);
+    table_render_into(table, res, size);
+    res[size] = '\0';
+    return res;
+}
+
+// Writes content to a new temporary file, path holds its name afterwards
+static bool write_temp_file(char (*path)[32], const char *content)
+{
+    strcpy(*path, "/tmp/ctable_test_XXXXXX");
+    int fd = mkstemp(*path);
+    if (fd < 0) return false;
+    FILE *file = fdopen(fd, "w");
+    if (file == NULL)
+    {
+        close(fd);
+        remove(*path);
+        return false;
+    }
+    fputs(content, file);
+    fclose(file);
+    return true;
+}
+
+static bool check_csv(Vector *error_builder, const char *content, char delimiter, const char *case_name)
+{
+    char path[32];
+    if (!write_temp_file(&path, content))
+    {
+        strb_append(error_builder, "%s: Could not write a temporary file.\n", case_name);
+        return false;
+    }
+
+    Table *loaded = get_empty_table();
+    bool success = add_cells_from_csv(loaded, path, delimiter);
+    remove(path);
+    make_boxed(loaded, BORDER_SINGLE);
+    set_all_vlines(loaded, BORDER_SINGLE);
+
+    Table *expected = get_empty_table();
+    for (size_t i = 0; i < 4; i++)
+    {
+        for (size_t j = 0; j < 3 && EXPECTED[i][j] != NULL; j++)
+        {
+            add_cell(expected, EXPECTED[i][j]);
+        }
+        next_row(expected);
+    }
+    make_boxed(expected, BORDER_SINGLE);
+    set_all_vlines(expected, BORDER_SINGLE);
+
+    char *loaded_str = render(loaded);
+    char *expected_str = render(expected);
+    if (!success || strcmp(loaded_str, expected_str) != 0)
+    {
+        strb_append(error_builder, "%s: Loaded table differs:\n%s\nExpected:\n%s\n", case_name, loaded_str, expected_str);
+        success = false;
+    }
+
+    free(loaded_str);
+    free(expected_str);
+    free_table(loaded);
+    free_table(expected);
+    return success;
+}
+
+bool csv_test(Vector *error_builder)
+{
+    bool success = true;
+    // Case 1
+    if (!check_csv(error_builder, CSV_CONTENT, ',', "Case 1")) success = false;
+    // Case 2
+    if (!check_csv(error_builder, TSV_CONTENT, '\t', "Case 2")) success = false;
+    return success;
+}
+
+Test get_csv_test()
+{
+    return (Test){
+        csv_test,
+        NUM_CASES,
+        "CSV"
+    };
+}
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_export.h"
+#include "../src/table.h"
+#include "../src/string_builder.h"
+
+#define NUM_CASES 4
+
+#define BOLD      "\x1B[1m"
+#define COL_RESET "\x1B[0m"
+
+static const char *EXPECTED[] = {
+    "Name,Value,Comment\n"
+    "\"a,\"\"b\"\"\",\"a,\"\"b\"\"\",\"multi\nline\"\n"
+    "c,,\n",
+
+    "Name\tValue\tComment\n"
+    "a,\"b\"\ta,\"b\"\tmulti\\nline\n"
+    "c\t\t\n",
+
+    "| Name | Value | Comment |\n"
+    "| --- | --: | --- |\n"
+    "| a,\"b\" | a,\"b\" | multi<br>line |\n"
+    "| c |  |  |\n",
+
+    "{\"Name\":\"a,\\\"b\\\"\",\"Value\":\"a,\\\"b\\\"\",\"Comment\":\"multi\\nline\"}\n"
+    "{\"Name\":\"c\",\"Value\":\"\",\"Comment\":\"\"}\n",
+};
+
+static Table *get_test_table()
+{
+    Table *table = get_empty_table();
+    set_default_alignments(table, 2, (TableHAlign[]){ H_ALIGN_LEFT, H_ALIGN_RIGHT }, NULL);
+    add_cells(table, 3, " Name ", BOLD " Value " COL_RESET, " Comment ");
+    next_row(table);
+    set_span(table, 2, 1);
+    add_cell(table, " a,\"b\" ");
+    add_cell(table, " multi\n line ");
+    next_row(table);
+    add_cell(table, " c ");
+    next_row(table);
+    make_boxed(table, BORDER_SINGLE);
+    set_all_vlines(table, BORDER_SINGLE);
+    return table;
+}
+
+bool export_test(Vector *error_builder)
+{
+    bool success = true;
+    Table *table = get_test_table();
+
+    // Case 1 - 4: One case for each format
+    for (TableFormat format = TABLE_FORMAT_CSV; format <= TABLE_FORMAT_NDJSON; format++)
+    {
+        FILE *file = tmpfile();
+        fprint_table_as(table, file, format);
+        size_t length = ftell(file);
+        rewind(file);
+        char *result = malloc(length + 1);
+        result[fread(result, 1, length, file)] = '\0';
+        fclose(file);
+
+        if (strcmp(result, EXPECTED[format]) != 0)
+        {
+            strb_append(error_builder, "Case %d: Got\n%s\nExpected:\n%s\n", format + 1, result, EXPECTED[format]);
+            success = false;
+        }
+        free(result);
+    }
+
+    free_table(table);
+    return success;
+}
+
+Test get_export_test()
+{
+    return (Test){
+        export_test,
+        NUM_CASES,
+        "Export"
+    };
+}
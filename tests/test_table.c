@@ -1,11 +1,17 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
 
 #include "test_table.h"
 #include "../src/table.h"
+#include "../src/table_schema.h"
 #include "../src/vector.h"
+#include "../src/string_builder.h"
 
-#define NUM_CASES 4
+#define NUM_CASES 26
 #define MAX_COLS 11
 
 #define GREEN     "\x1B[92m"
@@ -21,7 +27,203 @@ const char *arrayA[4][4] = {
     { " 3....... ", RED " 23.1132310 " COL_RESET, "c ", " 333" },
 };
 
-bool table_test(__attribute__((unused)) Vector *error_builder)
+// Creates an empty temporary file, path holds its name afterwards
+static bool create_temp_file(char (*path)[32])
+{
+    strcpy(*path, "/tmp/ctable_test_XXXXXX");
+    int fd = mkstemp(*path);
+    if (fd < 0) return false;
+    close(fd);
+    return true;
+}
+
+// Reads back everything fprint_table wrote to a temporary file
+static char *render_with_stream(Table *table, size_t *out_length)
+{
+    FILE *file = tmpfile();
+    fprint_table(table, file);
+    *out_length = ftell(file);
+    rewind(file);
+    char *res = malloc(*out_length + 1);
+    *out_length = fread(res, 1, *out_length, file);
+    fclose(file);
+    return res;
+}
+
+// Reads back everything fprint_table_as wrote to a temporary file as \0-terminated string
+static char *export_with_stream(Table *table, TableFormat format)
+{
+    FILE *file = tmpfile();
+    fprint_table_as(table, file, format);
+    size_t length = ftell(file);
+    rewind(file);
+    char *res = malloc(length + 1);
+    res[fread(res, 1, length, file)] = '\0';
+    fclose(file);
+    return res;
+}
+
+static bool is_error_row(size_t row_index, const TableText *cells, size_t num_cols, void *context)
+{
+    (void)context;
+    return row_index == 0 || (num_cols > 1 && cells[1].text != NULL && strncmp(cells[1].text, "error", cells[1].length) == 0);
+}
+
+// Table with an empty last row and col, whose borders are hidden when printing
+static Table *get_boxed_table()
+{
+    Table *table = get_empty_table();
+    add_cells_from_array(table, 4, 4, (const char**)arrayA);
+    set_span(table, 2, 2);
+    add_cell(table, " double \n boxed ");
+    next_row(table);
+    make_boxed(table, BORDER_DOUBLE);
+    set_all_vlines(table, BORDER_SINGLE);
+    return table;
+}
+
+// Log-like table with spans, styles and multi-line cells in rows that are complete before the last one
+static void fill_log_table(Table *table)
+{
+    add_cells(table, 3, "id", "level", "message");
+    set_hline(table, BORDER_DOUBLE);
+    next_row(table);
+    for (size_t i = 0; i < 300; i++)
+    {
+        if (i == 150) set_span(table, 1, 3);
+        add_cell_fmt(table, "%zu", i * 37);
+        if (i % 7 == 0) override_style(table, (TableStyle){ COLOR_RED, COLOR_DEFAULT, true });
+        add_cell(table, i % 5 == 0 ? "error" : "info");
+        if (i % 11 == 0)
+        {
+            add_cell_fmt(table, "line %zu\nwrapped " YELLOW "%zu" COL_RESET, i, i * i);
+        }
+        else if (i % 13 == 0)
+        {
+            override_above_border(table, BORDER_SINGLE);
+            set_span(table, 2, 1);
+            add_cell(table, "spanning two cols");
+        }
+        else
+        {
+            add_cell_fmt(table, "message %zu", i);
+        }
+        next_row(table);
+    }
+    set_span(table, 1, 2);
+    add_cell(table, "tall");
+    make_boxed(table, BORDER_SINGLE);
+    set_all_vlines(table, BORDER_SINGLE);
+}
+
+// Adds subtable either as nested table or as a text it was rendered to before
+static void add_subtable(Table *table, Table *subtable, bool is_nested)
+{
+    if (is_nested)
+    {
+        add_cell_table(table, subtable);
+        return;
+    }
+    size_t length;
+    char *text = render_with_stream(subtable, &length);
+    text[length - 1] = '\0';
+    add_cell_gc(table, text);
+}
+
+// Table that contains inner itself
+static Table *get_middle_table(Table *inner, bool is_nested)
+{
+    Table *table = get_empty_table();
+    add_cell(table, "middle");
+    add_subtable(table, inner, is_nested);
+    set_border_glyphs(table, GLYPHS_ASCII);
+    make_boxed(table, BORDER_DOUBLE);
+    return table;
+}
+
+// Dashboard of boxed and middle, boxed is replaced by a text if NULL
+static Table *get_dashboard(Table *boxed, Table *middle, bool is_nested)
+{
+    Table *table = get_empty_table();
+    add_cell(table, "boxed");
+    if (boxed != NULL)
+    {
+        add_subtable(table, boxed, is_nested);
+    }
+    else
+    {
+        add_cell(table, "replaced");
+    }
+    next_row(table);
+    override_vertical_alignment(table, V_ALIGN_CENTER);
+    add_cell(table, "middle");
+    override_horizontal_alignment(table, H_ALIGN_RIGHT);
+    add_subtable(table, middle, is_nested);
+    add_cell(table, "right");
+    make_boxed(table, BORDER_SINGLE);
+    set_all_vlines(table, BORDER_SINGLE);
+    return table;
+}
+
+// Compares the first lines, which are the top borders of boxed tables
+static bool has_same_first_line(const char *a, const char *b)
+{
+    size_t length = strchr(a, '\n') - a;
+    return strncmp(a, b, length + 1) == 0;
+}
+
+// Sink that collects output and counts the calls it receives
+struct TestSink
+{
+    StringBuilder output;
+    size_t num_writes;
+    size_t num_flushes;
+};
+
+static void write_to_test_sink(void *context, const char *bytes, size_t length)
+{
+    struct TestSink *sink = context;
+    strb_append(&sink->output, "%.*s", (int)length, bytes);
+    sink->num_writes++;
+}
+
+static void flush_test_sink(void *context)
+{
+    ((struct TestSink*)context)->num_flushes++;
+}
+
+static bool is_breach(const char *text, size_t length, void *context)
+{
+    return length == strlen(context) && memcmp(text, context, length) == 0;
+}
+
+#define TRADES(COL)                     \
+    COL(symbol, TEXT,  0, H_ALIGN_LEFT)  \
+    COL(qty,    INT,   6, H_ALIGN_RIGHT) \
+    COL(volume, UINT,  0, H_ALIGN_RIGHT) \
+    COL(price,  FLOAT, 0, H_ALIGN_CENTER)
+TABLE_SCHEMA(trades, TRADES)
+
+// Allocator that counts live allocations
+static void *tracking_alloc(void *context, size_t size)
+{
+    (*(int*)context)++;
+    return malloc(size);
+}
+
+static void *tracking_realloc(void *context, void *ptr, size_t size)
+{
+    if (ptr == NULL) (*(int*)context)++;
+    return realloc(ptr, size);
+}
+
+static void tracking_free(void *context, void *ptr)
+{
+    if (ptr != NULL) (*(int*)context)--;
+    free(ptr);
+}
+
+bool table_test(Vector *error_builder)
 {
     // Case 1
     Table *t1 = get_empty_table();
@@ -113,8 +315,1071 @@ bool table_test(__attribute__((unused)) Vector *error_builder)
     make_boxed(t4, BORDER_SINGLE);
     print_table(t4);
     free_table(t4);
-    
-    return true;
+
+    // Case 5: Rendering into buffer must match stream output byte for byte
+    Table *t5 = get_empty_table();
+    add_cells_from_array(t5, 4, 4, (const char**)arrayA);
+    set_span(t5, 2, 2);
+    add_cell(t5, " double \n boxed ");
+    next_row(t5);
+    make_boxed(t5, BORDER_DOUBLE);
+    set_all_vlines(t5, BORDER_SINGLE);
+    size_t stream_length = 0;
+    char *expected = render_with_stream(t5, &stream_length);
+    size_t size = table_rendered_size(t5);
+    char *buffer = malloc(size);
+    size_t written = table_render_into(t5, buffer, size);
+    char small_buffer[16];
+    size_t truncated = table_render_into(t5, small_buffer, sizeof(small_buffer));
+    free_table(t5);
+
+    bool success = true;
+    if (size != stream_length || written != size || memcmp(buffer, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 5: table_render_into does not match fprint_table.\n");
+        success = false;
+    }
+    if (truncated != size || memcmp(small_buffer, expected, sizeof(small_buffer)) != 0)
+    {
+        strb_append(error_builder, "Case 5: Truncated rendering is wrong.\n");
+        success = false;
+    }
+    free(buffer);
+    free(expected);
+
+    // Case 6: Statistics (only available when compiled with -DTABLE_STATS)
+    Table *t6 = get_empty_table();
+    set_span(t6, 2, 1);
+    add_cell(t6, "span");
+    next_row(t6);
+    add_cell(t6, "multi\nline");
+    add_cell_fmt(t6, "%d", 42);
+    next_row(t6);
+    size = table_rendered_size(t6);
+    TableStats stats;
+    if (table_get_stats(t6, &stats))
+    {
+        if (stats.num_cells != 3
+            || stats.num_spans != 1
+            || stats.num_multiline_cells != 1
+            || stats.num_rows != 3
+            || stats.bytes_emitted != size
+            || stats.num_allocations == 0
+            || stats.total_ns < stats.dimensions_ns)
+        {
+            strb_append(error_builder, "Case 6: Unexpected statistics.\n");
+            success = false;
+        }
+    }
+    free_table(t6);
+
+    // Case 7: Custom allocator needs to be used for all allocations
+    int num_live_allocations = 0;
+    Allocator allocator = {
+        .alloc   = tracking_alloc,
+        .realloc = tracking_realloc,
+        .free    = tracking_free,
+        .context = &num_live_allocations
+    };
+    Table *t7 = get_empty_table_with_allocator(&allocator);
+    add_cells_from_array(t7, 4, 4, (const char**)arrayA);
+    add_cell_fmt(t7, " %s ", "formatted");
+    char *gc_text = allocator.alloc(allocator.context, 4);
+    strcpy(gc_text, "gc");
+    add_cell_gc(t7, gc_text);
+    make_boxed(t7, BORDER_SINGLE);
+    table_rendered_size(t7);
+    if (num_live_allocations <= 1)
+    {
+        strb_append(error_builder, "Case 7: Allocator not used.\n");
+        success = false;
+    }
+    free_table(t7);
+    if (num_live_allocations != 0)
+    {
+        strb_append(error_builder, "Case 7: %d allocations leaked.\n", num_live_allocations);
+        success = false;
+    }
+
+    // Layouts, renderers and loaded tables are obtained from the allocator as well
+    TableLayout *t7_layout = get_table_layout_with_allocator(&allocator);
+    TableRenderer *t7_renderer = get_table_renderer_with_allocator(NULL, NULL, &allocator);
+    Table *t7_submitted = get_empty_table_with_allocator(&allocator);
+    add_cells_from_array(t7_submitted, 4, 4, (const char**)arrayA);
+    table_renderer_submit(t7_renderer, t7_submitted);
+    const char *t7_output;
+    size_t t7_length;
+    struct pollfd t7_ready = { .fd = table_renderer_fd(t7_renderer), .events = POLLIN };
+    while (!table_renderer_take(t7_renderer, &t7_output, &t7_length)) poll(&t7_ready, 1, -1);
+    char t7_path[32];
+    Table *t7_saved = get_boxed_table();
+    Table *t7_loaded = create_temp_file(&t7_path) && table_save(t7_saved, t7_path)
+        ? table_load_mapped_with_allocator(t7_path, &allocator) : NULL;
+    if (t7_loaded == NULL || t7_length == 0 || num_live_allocations <= 3)
+    {
+        strb_append(error_builder, "Case 7: Allocator not used for layout, renderer or loaded table.\n");
+        success = false;
+    }
+    if (t7_loaded != NULL) free_table(t7_loaded);
+    free_table(t7_saved);
+    free_table_renderer(t7_renderer);
+    free_table_layout(t7_layout);
+    remove(t7_path);
+    if (num_live_allocations != 0)
+    {
+        strb_append(error_builder, "Case 7: %d allocations of layout, renderer or loaded table leaked.\n", num_live_allocations);
+        success = false;
+    }
+
+    // Case 8: Frozen plan prints like the table, printing does not change the table
+    Table *printed = get_boxed_table();
+    char *rendered = render_with_stream(printed, &stream_length);
+    TablePlan *plan = table_freeze(printed);
+    size_t plan_size = table_plan_size(plan);
+    char *plan_buffer = malloc(plan_size);
+    table_plan_render_into(plan, plan_buffer, plan_size);
+    if (plan_size != stream_length || memcmp(plan_buffer, rendered, plan_size) != 0)
+    {
+        strb_append(error_builder, "Case 8: Plan does not match fprint_table.\n");
+        success = false;
+    }
+    free_table_plan(plan);
+    free(plan_buffer);
+    free(rendered);
+
+    // Borders of the previously empty last col must appear like in a table that was never printed
+    Table *unprinted = get_boxed_table();
+    set_position(printed, 4, 0);
+    add_cell(printed, " late ");
+    set_position(unprinted, 4, 0);
+    add_cell(unprinted, " late ");
+    rendered = render_with_stream(printed, &stream_length);
+    expected = render_with_stream(unprinted, &size);
+    if (size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 8: Printing changed the table.\n");
+        success = false;
+    }
+    free(rendered);
+    free(expected);
+    free_table(printed);
+    free_table(unprinted);
+
+    // Case 9: Styles emit color codes only where the style changes
+    Table *t9 = get_empty_table();
+    set_default_style(t9, 1, (TableStyle){ COLOR_GREEN, COLOR_DEFAULT, false });
+    add_cells(t9, 3, "a", "b", "c");
+    next_row(t9);
+    override_style_of_row(t9, (TableStyle){ COLOR_RED, COLOR_DEFAULT, true });
+    add_cells(t9, 2, "d", "e");
+    override_style(t9, (TableStyle){ COLOR_DEFAULT, COLOR_BRIGHT_BLUE, false });
+    add_cell(t9, "f");
+    rendered = render_with_stream(t9, &stream_length);
+    const char *styled = "a\x1B[32mb\x1B[0mc\n\x1B[1;31mde\x1B[22;39;104mf\x1B[0m\n";
+    if (stream_length != strlen(styled) || memcmp(rendered, styled, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 9: Unexpected color codes.\n");
+        success = false;
+    }
+    free(rendered);
+    free_table(t9);
+
+    // Case 10: Compact output drops trailing whitespace, also when rendering into buffers
+    Table *t10 = get_empty_table();
+    add_cells(t10, 2, "a", "bb");
+    next_row(t10);
+    add_cell(t10, "cccccc");
+    next_row(t10);
+    add_cell(t10, "d ");
+    set_compact_output(t10, COMPACT_TRIM);
+    const char *compact = "a     bb\ncccccc\nd\n";
+    char compact_buffer[32];
+    size = table_render_into(t10, compact_buffer, sizeof(compact_buffer));
+    if (size != strlen(compact) || table_rendered_size(t10) != size || memcmp(compact_buffer, compact, size) != 0)
+    {
+        strb_append(error_builder, "Case 10: Whitespace was not trimmed.\n");
+        success = false;
+    }
+    free_table(t10);
+
+    // Case 11: Sorting rows keeps header and rows of vertical spans in place
+    Table *t11 = get_empty_table();
+    add_cells(t11, 2, "name", "value");
+    next_row(t11);
+    add_cells(t11, 2, " b ", " 10 ");
+    next_row(t11);
+    add_cells(t11, 2, "a", "9");
+    next_row(t11);
+    set_span(t11, 1, 2);
+    add_cells(t11, 2, "spanning", "1");
+    next_row(t11);
+    add_cell(t11, "0");
+    next_row(t11);
+    add_cells(t11, 2, "c", YELLOW "2.5" COL_RESET);
+    next_row(t11);
+    add_cells(t11, 2, "d", "x");
+    next_row(t11);
+    // Only decimal numbers are numbers
+    add_cells(t11, 2, "e", "inf");
+    next_row(t11);
+    add_cells(t11, 2, "f", "0x1");
+    next_row(t11);
+    add_cells(t11, 2, "g", "-1e1");
+    table_sort_rows(t11, 1, SORT_NUMERIC, NULL, 1, 100);
+    char *sorted = export_with_stream(t11, TABLE_FORMAT_CSV);
+    const char *expected_sorted = "name,value\ng,-1e1\nc,2.5\nspanning,1\nspanning,0\na,9\nb,10\nf,0x1\ne,inf\nd,x\n";
+    if (strcmp(sorted, expected_sorted) != 0)
+    {
+        strb_append(error_builder, "Case 11: Unexpected order:\n%s", sorted);
+        success = false;
+    }
+    free(sorted);
+    free_table(t11);
+
+    // Hlines and the empty row after the last one stay where they are when printed
+    Table *t11_sorted = get_empty_table();
+    Table *t11_built = get_empty_table();
+    const char *t11_keys[2][3] = { { "b", "a", "c" }, { "a", "b", "c" } };
+    Table *t11_tables[2] = { t11_sorted, t11_built };
+    for (size_t i = 0; i < 2; i++)
+    {
+        add_cell(t11_tables[i], "header");
+        next_row(t11_tables[i]);
+        set_hline(t11_tables[i], BORDER_DOUBLE);
+        for (size_t j = 0; j < 3; j++)
+        {
+            add_cell(t11_tables[i], t11_keys[i][j]);
+            next_row(t11_tables[i]);
+        }
+        make_boxed(t11_tables[i], BORDER_SINGLE);
+    }
+    table_sort_rows(t11_sorted, 0, SORT_LEXICOGRAPHIC, NULL, 1, 100);
+    expected = render_with_stream(t11_built, &size);
+    rendered = render_with_stream(t11_sorted, &stream_length);
+    if (size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 11: Sorted table printed:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    free_table(t11_sorted);
+    free_table(t11_built);
+
+    // Large tables are sorted in parallel, rows with equal keys keep their order
+    Table *large = get_empty_table();
+    for (size_t i = 0; i < 50000; i++)
+    {
+        add_cell_fmt(large, "%zu", (i * 7919) % 1000);
+        add_cell_fmt(large, "%zu", i);
+        next_row(large);
+    }
+    table_sort_rows(large, 0, SORT_NUMERIC, NULL, 0, 50000);
+    sorted = export_with_stream(large, TABLE_FORMAT_CSV);
+    size_t prev_key = 0, prev_index = 0, num_sorted = 0;
+    for (char *line = sorted; *line != '\0'; line = strchr(line, '\n') + 1)
+    {
+        size_t key = strtoul(line, &line, 10);
+        size_t index = strtoul(line + 1, NULL, 10);
+        if (key < prev_key || (key == prev_key && num_sorted > 0 && index < prev_index)) break;
+        prev_key = key;
+        prev_index = index;
+        num_sorted++;
+    }
+    if (num_sorted != 50000)
+    {
+        strb_append(error_builder, "Case 11: Large table is not sorted stably.\n");
+        success = false;
+    }
+    free(sorted);
+    free_table(large);
+
+    // Case 12: View prints selected rows and cols like a table containing only them
+    const char *log[5][3] = {
+        { " id ", "level", " message " },
+        { " 1 ", "info", " started " },
+        { " 2 ", "error", " disk full, retrying later " },
+        { " 3 ", "info", " stopped " },
+        { " 4 ", "error", " failed " },
+    };
+    Table *t12 = get_empty_table();
+    add_cells_from_array(t12, 3, 5, (const char**)log);
+    set_all_vlines(t12, BORDER_SINGLE);
+    make_boxed(t12, BORDER_SINGLE);
+    TableView *view = get_table_view(t12);
+    view_filter_rows(view, is_error_row, NULL);
+    view_select_cols(view, 2, (size_t[]){ 2, 0 });
+    FILE *file = tmpfile();
+    fprint_table_view(view, file);
+    size = ftell(file);
+    rewind(file);
+    rendered = malloc(size);
+    size = fread(rendered, 1, size, file);
+    fclose(file);
+    free_table_view(view);
+
+    // Selected rows are kept in their order, repeated and out of range ones included
+    view = get_table_view(t12);
+    view_select_rows(view, 6, (size_t[]){ 0, 4, 3, 9, 2, 4 });
+    view_filter_rows(view, is_error_row, NULL);
+    view_select_cols(view, 2, (size_t[]){ 2, 0 });
+    file = tmpfile();
+    fprint_table_view(view, file);
+    size_t reordered_size = ftell(file);
+    rewind(file);
+    char *reordered = malloc(reordered_size);
+    reordered_size = fread(reordered, 1, reordered_size, file);
+    fclose(file);
+    free_table_view(view);
+    free_table(t12);
+
+    Table *t12_reordered = get_empty_table();
+    for (size_t i = 0; i < 4; i++)
+    {
+        size_t index = (size_t[]){ 0, 4, 2, 4 }[i];
+        add_cells(t12_reordered, 2, log[index][2], log[index][0]);
+        next_row(t12_reordered);
+    }
+    set_all_vlines(t12_reordered, BORDER_SINGLE);
+    make_boxed(t12_reordered, BORDER_SINGLE);
+    expected = render_with_stream(t12_reordered, &stream_length);
+    if (reordered_size != stream_length || memcmp(reordered, expected, reordered_size) != 0)
+    {
+        strb_append(error_builder, "Case 12: Reordered view differs:\n%.*s\nExpected:\n%.*s\n", (int)reordered_size, reordered, (int)stream_length, expected);
+        success = false;
+    }
+    free(reordered);
+    free(expected);
+    free_table(t12_reordered);
+
+    Table *projected = get_empty_table();
+    // Header and error rows
+    for (size_t i = 0; i < 5; i += 2)
+    {
+        add_cells(projected, 2, log[i][2], log[i][0]);
+        next_row(projected);
+    }
+    set_all_vlines(projected, BORDER_SINGLE);
+    make_boxed(projected, BORDER_SINGLE);
+    expected = render_with_stream(projected, &stream_length);
+    if (size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 12: View differs:\n%.*s\nExpected:\n%.*s\n", (int)size, rendered, (int)stream_length, expected);
+        success = false;
+    }
+    free(rendered);
+    free(expected);
+    free_table(projected);
+
+    // Case 13: Tall span creates no rows, cursor skips cells it spans over in rows added later
+    Table *t13 = get_empty_table();
+    set_span(t13, 1, 100000);
+    add_cell(t13, "side\nnote");
+    add_cell(t13, "a");
+    if (table_get_stats(t13, &stats) && stats.num_rows != 1)
+    {
+        strb_append(error_builder, "Case 13: Span created %zu rows\n", stats.num_rows);
+        success = false;
+    }
+    next_row(t13);
+    add_cell(t13, "b");
+    next_row(t13);
+    add_cell(t13, "c");
+    const char *expected_span = "sidea\nnoteb\n    c\n";
+    rendered = render_with_stream(t13, &stream_length);
+    if (strlen(expected_span) != stream_length || memcmp(rendered, expected_span, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 13: Rendered:\n%.*s\nExpected:\n%s\n", (int)stream_length, rendered, expected_span);
+        success = false;
+    }
+    free(rendered);
+    free_table(t13);
+
+    // Case 14: ASCII glyphs take a single byte, custom glyphs replace the default ones
+    Table *t14 = get_empty_table();
+    add_cells(t14, 2, "a", "b");
+    next_row(t14);
+    set_hline(t14, BORDER_DOUBLE);
+    add_cells(t14, 2, "c", "d");
+    next_row(t14);
+    make_boxed(t14, BORDER_SINGLE);
+    set_all_vlines(t14, BORDER_SINGLE);
+    set_border_glyphs(t14, GLYPHS_ASCII);
+    const char *expected_ascii = "+-+-+\n|a|b|\n+=+=+\n|c|d|\n+-+-+\n";
+    rendered = render_with_stream(t14, &stream_length);
+    if (strlen(expected_ascii) != stream_length || memcmp(rendered, expected_ascii, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 14: Rendered:\n%.*s\nExpected:\n%s\n", (int)stream_length, rendered, expected_ascii);
+        success = false;
+    }
+    free(rendered);
+
+    TableBorderGlyphs glyphs = {
+        { "1", "2", "3", "4", "5", "6", "7", "8", "9", "-", "|" },
+        { "╔", "╦", "╗", "╠", "╬", "╣", "╚", "╩", "╝", "=", "║" }
+    };
+    set_custom_border_glyphs(t14, &glyphs);
+    const char *expected_custom = "1-2-3\n|a|b|\n4=5=6\n|c|d|\n7-8-9\n";
+    rendered = render_with_stream(t14, &stream_length);
+    if (strlen(expected_custom) != stream_length || memcmp(rendered, expected_custom, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 14: Rendered:\n%.*s\nExpected:\n%s\n", (int)stream_length, rendered, expected_custom);
+        success = false;
+    }
+    free(rendered);
+    free_table(t14);
+
+    // Case 15: Limits truncate, wrap and cut off lines of cells, ellipses match the glyphs
+    Table *t15 = get_empty_table();
+    add_cells(t15, 3, "abcdefgh", "aa bb cc", "x\ny\nz");
+    set_max_width(t15, 0, 5, OVERFLOW_TRUNCATE);
+    set_max_width(t15, 1, 5, OVERFLOW_WRAP);
+    set_max_lines(t15, 2, 2);
+    const char *expected_limited = "abcd\xE2\x80\xA6" "aa bbx\n     cc   \xE2\x80\xA6\n";
+    rendered = render_with_stream(t15, &stream_length);
+    if (strlen(expected_limited) != stream_length || memcmp(rendered, expected_limited, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 15: Rendered:\n%.*s\nExpected:\n%s\n", (int)stream_length, rendered, expected_limited);
+        success = false;
+    }
+    free(rendered);
+
+    // ASCII output stays ASCII, the ellipsis is cut to fit narrow cols
+    set_border_glyphs(t15, GLYPHS_ASCII);
+    expected_limited = "ab...aa bbx\n     cc   .\n";
+    rendered = render_with_stream(t15, &stream_length);
+    if (strlen(expected_limited) != stream_length || memcmp(rendered, expected_limited, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 15: Rendered with ASCII glyphs:\n%.*s\nExpected:\n%s\n", (int)stream_length, rendered, expected_limited);
+        success = false;
+    }
+    free(rendered);
+    free_table(t15);
+
+    // Case 16: Rendering in chunks of any size yields the same output
+    Table *t16 = get_boxed_table();
+    expected = render_with_stream(t16, &stream_length);
+    const size_t chunk_sizes[] = { 1, 7, 4096 };
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++)
+    {
+        rendered = malloc(stream_length + 4096);
+        size = 0;
+        TableRenderIterator *it = table_render_begin(t16);
+        size_t length;
+        while ((length = table_render_next(it, rendered + size, chunk_sizes[i])) > 0)
+        {
+            if (length > chunk_sizes[i] || size + length > stream_length) break;
+            size += length;
+        }
+        table_render_end(it);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 16: Chunks of %zu bytes differ:\n%.*s\n", chunk_sizes[i], (int)size, rendered);
+            success = false;
+        }
+        free(rendered);
+    }
+    free(expected);
+    free_table(t16);
+
+    // Case 17: Spilled rows are printed and exported like rows in memory
+    Table *t17_memory = get_empty_table();
+    Table *t17_spilled = get_empty_table();
+    set_memory_budget(t17_spilled, 4096);
+    fill_log_table(t17_memory);
+    fill_log_table(t17_spilled);
+    expected = render_with_stream(t17_memory, &size);
+    rendered = render_with_stream(t17_spilled, &stream_length);
+    if (table_get_stats(t17_spilled, &stats) && stats.num_spilled_rows == 0)
+    {
+        strb_append(error_builder, "Case 17: No row was spilled\n");
+        success = false;
+    }
+    if (size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 17: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    expected = export_with_stream(t17_memory, TABLE_FORMAT_NDJSON);
+    rendered = export_with_stream(t17_spilled, TABLE_FORMAT_NDJSON);
+    if (strcmp(rendered, expected) != 0)
+    {
+        strb_append(error_builder, "Case 17: Exported:\n%s\nExpected:\n%s\n", rendered, expected);
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    // Rows spilled between prints are mapped after the ones printed before, plans keep printing the old ones
+    TablePlan *t17_plan = table_freeze(t17_spilled);
+    size_t t17_frozen_length;
+    char *t17_frozen = render_with_stream(t17_spilled, &t17_frozen_length);
+    for (size_t i = 0; i < 200; i++)
+    {
+        add_cell_fmt(t17_memory, "more %zu", i);
+        add_cell_fmt(t17_spilled, "more %zu", i);
+        next_row(t17_memory);
+        next_row(t17_spilled);
+        if (i % 50 != 49) continue;
+        expected = render_with_stream(t17_memory, &size);
+        rendered = render_with_stream(t17_spilled, &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 17: After %zu more rows rendered:\n%.*s\n", i + 1, (int)stream_length, rendered);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+    }
+    rendered = malloc(t17_frozen_length);
+    if (table_plan_render_into(t17_plan, rendered, t17_frozen_length) != t17_frozen_length
+        || memcmp(rendered, t17_frozen, t17_frozen_length) != 0)
+    {
+        strb_append(error_builder, "Case 17: Plan differs after more rows were spilled\n");
+        success = false;
+    }
+    free(rendered);
+    free(t17_frozen);
+    free_table_plan(t17_plan);
+    free_table(t17_memory);
+    free_table(t17_spilled);
+    // Rows spilled after freezing keep their texts for the plan
+    Table *t17_late = get_empty_table();
+    fill_log_table(t17_late);
+    t17_plan = table_freeze(t17_late);
+    t17_frozen = render_with_stream(t17_late, &t17_frozen_length);
+    set_memory_budget(t17_late, 1000);
+    for (size_t i = 0; i < 100; i++)
+    {
+        add_cell_fmt(t17_late, "late %zu", i);
+        next_row(t17_late);
+    }
+    rendered = malloc(t17_frozen_length);
+    if (table_get_stats(t17_late, &stats) && stats.num_spilled_rows == 0)
+    {
+        strb_append(error_builder, "Case 17: No row was spilled after freezing\n");
+        success = false;
+    }
+    if (table_plan_render_into(t17_plan, rendered, t17_frozen_length) != t17_frozen_length
+        || memcmp(rendered, t17_frozen, t17_frozen_length) != 0)
+    {
+        strb_append(error_builder, "Case 17: Plan differs after its rows were spilled\n");
+        success = false;
+    }
+    free(rendered);
+    free(t17_frozen);
+    free_table_plan(t17_plan);
+    free_table(t17_late);
+    // Spilled rows keep the widths of the limits they were spilled with, both paths print wider cells alike
+    char *t17_paths[2];
+    size_t t17_lengths[2];
+    for (size_t i = 0; i < 2; i++)
+    {
+        Table *t17_limited = get_empty_table();
+        set_memory_budget(t17_limited, 1000);
+        set_max_width(t17_limited, 1, 4, OVERFLOW_TRUNCATE);
+        for (size_t j = 0; j < 50; j++)
+        {
+            add_cell_fmt(t17_limited, "%zu", j);
+            add_cell_fmt(t17_limited, "message %zu", j);
+            next_row(t17_limited);
+        }
+        set_max_width(t17_limited, 1, 0, OVERFLOW_TRUNCATE);
+        // Overriding a border leaves the path for simple tables
+        if (i == 1) override_above_border(t17_limited, BORDER_NONE);
+        t17_paths[i] = render_with_stream(t17_limited, &t17_lengths[i]);
+        free_table(t17_limited);
+    }
+    if (t17_lengths[0] != t17_lengths[1] || memcmp(t17_paths[0], t17_paths[1], t17_lengths[0]) != 0)
+    {
+        strb_append(error_builder, "Case 17: Cells wider than their col printed:\n%.*s\nExpected:\n%.*s\n",
+            (int)t17_lengths[0], t17_paths[0], (int)t17_lengths[1], t17_paths[1]);
+        success = false;
+    }
+    free(t17_paths[0]);
+    free(t17_paths[1]);
+
+    // Case 18: A loaded snapshot is printed like the saved table, damaged snapshots are rejected
+    char snapshot_path[32];
+    if (!create_temp_file(&snapshot_path))
+    {
+        strb_append(error_builder, "Case 18: Temporary file could not be created\n");
+        success = false;
+    }
+    Table *t18 = get_empty_table();
+    set_border_glyphs(t18, GLYPHS_ROUNDED);
+    set_max_width(t18, 2, 12, OVERFLOW_WRAP);
+    fill_log_table(t18);
+    Table *t18_loaded = table_save(t18, snapshot_path) ? table_load_mapped(snapshot_path) : NULL;
+    if (t18_loaded == NULL)
+    {
+        strb_append(error_builder, "Case 18: Snapshot could not be saved and loaded\n");
+        success = false;
+    }
+    else
+    {
+        if (table_get_stats(t18_loaded, &stats) && stats.num_spilled_rows == 0)
+        {
+            strb_append(error_builder, "Case 18: No row is printed from the mapping\n");
+            success = false;
+        }
+        expected = render_with_stream(t18, &size);
+        rendered = render_with_stream(t18_loaded, &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 18: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+        expected = export_with_stream(t18, TABLE_FORMAT_CSV);
+        rendered = export_with_stream(t18_loaded, TABLE_FORMAT_CSV);
+        if (strcmp(rendered, expected) != 0)
+        {
+            strb_append(error_builder, "Case 18: Exported:\n%s\nExpected:\n%s\n", rendered, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+        free_table(t18_loaded);
+    }
+    FILE *snapshot = fopen(snapshot_path, "rb");
+    if (snapshot != NULL)
+    {
+        // Cut off second half
+        char *content = malloc(1 << 20);
+        size_t snapshot_length = fread(content, 1, 1 << 20, snapshot);
+        fclose(snapshot);
+        snapshot = fopen(snapshot_path, "wb");
+        fwrite(content, 1, snapshot_length / 2, snapshot);
+        fclose(snapshot);
+        free(content);
+        Table *damaged = table_load_mapped(snapshot_path);
+        if (damaged != NULL)
+        {
+            strb_append(error_builder, "Case 18: Damaged snapshot was loaded\n");
+            success = false;
+            free_table(damaged);
+        }
+    }
+    // Widths of cols in the metrics at the end of the file have to match the cells
+    Table *t18_plain = get_empty_table();
+    for (size_t i = 0; i < 10; i++)
+    {
+        add_cell_fmt(t18_plain, "row %zu", i);
+        next_row(t18_plain);
+    }
+    snapshot = table_save(t18_plain, snapshot_path) ? fopen(snapshot_path, "r+b") : NULL;
+    if (snapshot != NULL)
+    {
+        // Without spans, the metrics end with the widths of the cols, two counts and heights of the 9 mapped rows
+        unsigned long long narrow = 1;
+        fseek(snapshot, -(long)((TABLE_MAX_COLS + 2 + 9) * sizeof(narrow)), SEEK_END);
+        fwrite(&narrow, sizeof(narrow), 1, snapshot);
+        fclose(snapshot);
+    }
+    Table *t18_narrow = table_load_mapped(snapshot_path);
+    if (snapshot == NULL || t18_narrow != NULL)
+    {
+        strb_append(error_builder, "Case 18: Snapshot with a narrowed col was loaded\n");
+        success = false;
+    }
+    if (t18_narrow != NULL) free_table(t18_narrow);
+    free_table(t18_plain);
+    remove(snapshot_path);
+    free_table(t18);
+
+    // Case 19: Simple tables are printed by the fast path like by the general one
+    Table *t19[2];
+    const TableHAlign t19_aligns[3] = { H_ALIGN_LEFT, H_ALIGN_RIGHT, H_ALIGN_CENTER };
+    for (size_t i = 0; i < 2; i++)
+    {
+        t19[i] = get_empty_table();
+        set_default_alignments(t19[i], 3, t19_aligns, NULL);
+        set_default_style(t19[i], 1, (TableStyle){ COLOR_RED, COLOR_DEFAULT, true });
+        add_cells_from_array(t19[i], 4, 4, (const char**)arrayA);
+        set_position(t19[i], 1, 2);
+        override_horizontal_alignment(t19[i], H_ALIGN_CENTER);
+        set_position(t19[i], 0, 1);
+        set_hline(t19[i], BORDER_DOUBLE);
+        set_vline(t19[i], 2, BORDER_SINGLE);
+        make_boxed(t19[i], BORDER_SINGLE);
+        set_compact_output(t19[i], COMPACT_TRIM);
+    }
+    // Overriding a border with the style it has anyway keeps the output, but takes the general path
+    set_position(t19[1], 3, 3);
+    override_left_border(t19[1], BORDER_NONE);
+    expected = render_with_stream(t19[1], &size);
+    rendered = render_with_stream(t19[0], &stream_length);
+    if (size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 19: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    free_table(t19[0]);
+    free_table(t19[1]);
+
+    // Case 20: Nested tables are printed like their renderings, changes of them and of tables nested into them show up
+    Table *t20_boxed = get_boxed_table();
+    set_border_glyphs(t20_boxed, GLYPHS_ASCII);
+    set_default_style(t20_boxed, 1, (TableStyle){ COLOR_RED, COLOR_DEFAULT, true });
+    Table *t20_inner = get_empty_table();
+    add_cell(t20_inner, "inner");
+    set_border_glyphs(t20_inner, GLYPHS_ASCII);
+    make_boxed(t20_inner, BORDER_SINGLE);
+    Table *t20_middle = get_middle_table(t20_inner, true);
+    Table *t20 = get_dashboard(t20_boxed, t20_middle, true);
+    // Plans keep printing the tables as they were frozen
+    TablePlan *t20_plan = table_freeze(t20);
+    size_t t20_frozen_length;
+    char *t20_frozen = render_with_stream(t20, &t20_frozen_length);
+    for (size_t i = 0; i < 4; i++)
+    {
+        if (i == 1)
+        {
+            set_position(t20_inner, 0, 1);
+            add_cell(t20_inner, "changed");
+        }
+        if (i == 3)
+        {
+            set_position(t20, 1, 0);
+            add_cell(t20, "replaced");
+        }
+        Table *middle = get_middle_table(t20_inner, false);
+        Table *dashboard = get_dashboard(i < 3 ? t20_boxed : NULL, middle, false);
+        expected = render_with_stream(dashboard, &size);
+        rendered = render_with_stream(t20, &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 20: Print %zu:\n%.*s\nExpected:\n%.*s\n", i, (int)stream_length, rendered, (int)size, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+        free_table(middle);
+        free_table(dashboard);
+    }
+    rendered = malloc(table_plan_size(t20_plan));
+    stream_length = table_plan_render_into(t20_plan, rendered, table_plan_size(t20_plan));
+    if (t20_frozen_length != stream_length || memcmp(rendered, t20_frozen, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 20: Plan printed:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)t20_frozen_length, t20_frozen);
+        success = false;
+    }
+    free(rendered);
+    free(t20_frozen);
+    free_table_plan(t20_plan);
+    free_table(t20);
+    free_table(t20_middle);
+    free_table(t20_inner);
+    free_table(t20_boxed);
+
+    // Case 21: Tables sharing a layout are printed with the same widths, a table widening it later included
+    TableLayout *layout = get_table_layout();
+    const char *t21_cells[3][3] = {
+        { "a", "bb", "ccc" },
+        { "wide cell", "b", "" },
+        { "x", "y", "z" }
+    };
+    Table *t21[3];
+    char *t21_rendered[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        t21[i] = get_empty_table();
+        add_cells_from_array(t21[i], 3, 1, t21_cells[i]);
+        if (i == 2)
+        {
+            add_empty_cell(t21[i]);
+            set_span(t21[i], 2, 1);
+            add_cell(t21[i], "spanning two cols");
+            next_row(t21[i]);
+        }
+        make_boxed(t21[i], BORDER_SINGLE);
+        set_all_vlines(t21[i], BORDER_SINGLE);
+        table_use_layout(t21[i], layout);
+    }
+    set_position(t21[0], 0, 1);
+    add_cell(t21[0], "widened after all were measured");
+    for (size_t i = 0; i < 3; i++)
+    {
+        t21_rendered[i] = render_with_stream(t21[i], &size);
+    }
+    for (size_t i = 1; i < 3; i++)
+    {
+        if (!has_same_first_line(t21_rendered[0], t21_rendered[i]))
+        {
+            strb_append(error_builder, "Case 21: Widths differ:\n%s\n%s\n", t21_rendered[0], t21_rendered[i]);
+            success = false;
+        }
+    }
+    table_use_layout(t21[2], NULL);
+    free(t21_rendered[2]);
+    t21_rendered[2] = render_with_stream(t21[2], &size);
+    if (has_same_first_line(t21_rendered[0], t21_rendered[2]))
+    {
+        strb_append(error_builder, "Case 21: Table without layout is printed with its widths:\n%s\n", t21_rendered[2]);
+        success = false;
+    }
+    for (size_t i = 0; i < 3; i++)
+    {
+        free(t21_rendered[i]);
+        free_table(t21[i]);
+    }
+    free_table_layout(layout);
+
+    // Case 22: Sinks receive the output of fprint_table in few chunks and are flushed once
+    Table *t22 = get_empty_table();
+    fill_log_table(t22);
+    struct TestSink t22_sink = { strb_create(), 0, 0 };
+    print_table_to_sink(t22, &(TableSink){ write_to_test_sink, flush_test_sink, &t22_sink, false });
+    size = table_rendered_size(t22);
+    expected = malloc(size + 1);
+    expected[table_render_into(t22, expected, size)] = '\0';
+    size_t max_writes = size / TABLE_SINK_CHUNK_SIZE + 1;
+    if (strcmp(strb_to_str(&t22_sink.output), expected) != 0 || t22_sink.num_writes > max_writes || t22_sink.num_flushes != 1)
+    {
+        strb_append(error_builder, "Case 22: %zu writes, %zu flushes:\n%s\n", t22_sink.num_writes, t22_sink.num_flushes, strb_to_str(&t22_sink.output));
+        success = false;
+    }
+    free(expected);
+    strb_destroy(&t22_sink.output);
+    free_table(t22);
+
+    // Case 23: Style rules print like styles and alignments overridden by hand
+    const char *t23_cells[5][3] = {
+        { "service", "delta", "sla" },
+        { "api", " -3.5 ", "ok" },
+        { "ERR db", "12", "breach" },
+        { "cache", "-7", "ok" },
+        { "queue", "n/a", "breach" }
+    };
+    Table *t23_rules = get_empty_table();
+    Table *t23_manual = get_empty_table();
+    add_cells_from_array(t23_rules, 3, 5, (const char**)t23_cells);
+    add_cells_from_array(t23_manual, 3, 5, (const char**)t23_cells);
+    TableStyle red = { COLOR_RED, COLOR_DEFAULT, false };
+    TableStyle bold = { COLOR_DEFAULT, COLOR_DEFAULT, true };
+    add_style_rule(t23_rules, 1, &(TableStyleRule){ .kind = RULE_BELOW, .threshold = 0, .sets_style = true, .style = red });
+    add_style_rule(t23_rules, 1, &(TableStyleRule){ .kind = RULE_ABOVE, .threshold = 10, .sets_h_align = true, .h_align = H_ALIGN_RIGHT });
+    add_style_rule(t23_rules, 0, &(TableStyleRule){ .kind = RULE_PREFIX, .prefix = "ERR", .sets_style = true, .style = bold });
+    add_style_rule(t23_rules, 2, &(TableStyleRule){
+        .kind = RULE_CALLBACK, .predicate = is_breach, .context = "breach",
+        .sets_style = true, .style = red, .sets_h_align = true, .h_align = H_ALIGN_CENTER
+    });
+    // The style of a cell overrides the one of a rule
+    set_position(t23_rules, 1, 3);
+    override_style(t23_rules, bold);
+    set_position(t23_manual, 1, 1);
+    override_style(t23_manual, red);
+    set_position(t23_manual, 1, 2);
+    override_horizontal_alignment(t23_manual, H_ALIGN_RIGHT);
+    set_position(t23_manual, 1, 3);
+    override_style(t23_manual, bold);
+    set_position(t23_manual, 0, 2);
+    override_style(t23_manual, bold);
+    for (size_t i = 2; i <= 4; i += 2)
+    {
+        set_position(t23_manual, 2, i);
+        override_style(t23_manual, red);
+        override_horizontal_alignment(t23_manual, H_ALIGN_CENTER);
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        // Fast path first, general path once a border is overridden
+        expected = render_with_stream(t23_manual, &size);
+        rendered = render_with_stream(t23_rules, &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 23: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+        set_position(t23_rules, 0, 0);
+        override_left_border(t23_rules, BORDER_NONE);
+        set_position(t23_manual, 0, 0);
+        override_left_border(t23_manual, BORDER_NONE);
+    }
+    free_table(t23_rules);
+    free_table(t23_manual);
+
+    // Case 24: Tables with a row capacity print like tables of the rows they kept, evicted rows are freed
+    int t24_allocations = 0;
+    Allocator t24_allocator = {
+        .alloc   = tracking_alloc,
+        .realloc = tracking_realloc,
+        .free    = tracking_free,
+        .context = &t24_allocations
+    };
+    Table *t24_ring = get_empty_table_with_allocator(&t24_allocator);
+    set_row_capacity(t24_ring, 3);
+    set_vline(t24_ring, 1, BORDER_SINGLE);
+    add_cell_fmt(t24_ring, "%s", "a very wide first cell");
+    add_cell(t24_ring, "0");
+    int t24_steady_allocations = 0;
+    for (size_t i = 1; i <= 20; i++)
+    {
+        if (i == 10) t24_steady_allocations = t24_allocations;
+        next_row(t24_ring);
+        add_cell_fmt(t24_ring, "row %zu", i);
+        add_cell_fmt(t24_ring, "%zu", i * i);
+    }
+    if (t24_allocations != t24_steady_allocations)
+    {
+        strb_append(error_builder, "Case 24: %d allocations instead of %d\n", t24_allocations, t24_steady_allocations);
+        success = false;
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        // Then the middle row is replaced
+        const char *t24_cells[3][2] = {
+            { "row 18", "324" },
+            { i == 0 ? "row 19" : "new", i == 0 ? "361" : "-" },
+            { "row 20", "400" }
+        };
+        Table *t24_kept = get_empty_table();
+        set_vline(t24_kept, 1, BORDER_SINGLE);
+        add_cells_from_array(t24_kept, 2, 3, (const char**)t24_cells);
+        expected = render_with_stream(t24_kept, &size);
+        rendered = render_with_stream(t24_ring, &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 24: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+        free_table(t24_kept);
+        table_delete_row(t24_ring, 1);
+        table_insert_row(t24_ring, 1);
+        add_cells(t24_ring, 2, "new", "-");
+    }
+    // Rows removed while a plan exists are freed with it
+    size_t t24_frozen_length;
+    char *t24_frozen = render_with_stream(t24_ring, &t24_frozen_length);
+    TablePlan *t24_plan = table_freeze(t24_ring);
+    table_delete_row(t24_ring, 0);
+    set_position(t24_ring, 0, 2);
+    for (size_t i = 0; i < 4; i++)
+    {
+        add_cell_fmt(t24_ring, "later %zu", i);
+        next_row(t24_ring);
+    }
+    rendered = malloc(table_plan_size(t24_plan));
+    stream_length = table_plan_render_into(t24_plan, rendered, table_plan_size(t24_plan));
+    if (t24_frozen_length != stream_length || memcmp(rendered, t24_frozen, stream_length) != 0)
+    {
+        strb_append(error_builder, "Case 24: Plan printed:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)t24_frozen_length, t24_frozen);
+        success = false;
+    }
+    free(rendered);
+    free(t24_frozen);
+    free_table_plan(t24_plan);
+    free_table(t24_ring);
+    if (t24_allocations != 0)
+    {
+        strb_append(error_builder, "Case 24: %d allocations not freed\n", t24_allocations);
+        success = false;
+    }
+
+    // Case 25: Tables of a schema print like tables built cell by cell
+    Table *t25_schema = trades_table();
+    trades_append(t25_schema, "AAPL", 120, 3000000000ULL, 187.25);
+    trades_append(t25_schema, "ERR", -12, 0, 0.5);
+    const char *t25_cells[3][4] = {
+        { "symbol", "   qty", "volume", "price" },
+        { "AAPL", "120", "3000000000", "187.25" },
+        { "ERR", "-12", "0", "0.5" }
+    };
+    Table *t25_manual = get_empty_table();
+    TableHAlign t25_h_aligns[4] = { H_ALIGN_LEFT, H_ALIGN_RIGHT, H_ALIGN_RIGHT, H_ALIGN_CENTER };
+    TableVAlign t25_v_aligns[4] = { V_ALIGN_TOP, V_ALIGN_TOP, V_ALIGN_TOP, V_ALIGN_TOP };
+    set_default_alignments(t25_manual, 4, t25_h_aligns, t25_v_aligns);
+    add_cells_from_array(t25_manual, 4, 3, (const char**)t25_cells);
+    set_position(t25_manual, 0, 1);
+    set_hline(t25_manual, BORDER_SINGLE);
+    expected = render_with_stream(t25_manual, &size);
+    rendered = render_with_stream(t25_schema, &stream_length);
+    if (trades_num_cols != 4 || size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 25: Rendered:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+        success = false;
+    }
+    free(rendered);
+    // Fixed widths are kept by snapshots
+    create_temp_file(&snapshot_path);
+    Table *t25_loaded = table_save(t25_schema, snapshot_path) ? table_load_mapped(snapshot_path) : NULL;
+    rendered = t25_loaded != NULL ? render_with_stream(t25_loaded, &stream_length) : NULL;
+    if (rendered == NULL || size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 25: Loaded snapshot differs.\n");
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    if (t25_loaded != NULL) free_table(t25_loaded);
+    remove(snapshot_path);
+    // Fixed widths grow to wider cells, added before or after them
+    trades_append(t25_schema, "BIG", 1234567, 1, 2);
+    set_position(t25_manual, 0, 3);
+    add_cells(t25_manual, 4, "BIG", "1234567", "1", "2");
+    Table *t25_grown = get_empty_table();
+    add_cells(t25_grown, 2, "hello world", "1");
+    set_fixed_width(t25_grown, 0, 3);
+    next_row(t25_grown);
+    add_cells(t25_grown, 2, "a", "12345");
+    set_fixed_width(t25_grown, 1, 3);
+    Table *t25_measured = get_empty_table();
+    add_cells(t25_measured, 2, "hello world", "1");
+    next_row(t25_measured);
+    add_cells(t25_measured, 2, "a", "12345");
+    Table *t25_pairs[2][2] = { { t25_schema, t25_manual }, { t25_grown, t25_measured } };
+    for (size_t i = 0; i < 2; i++)
+    {
+        expected = render_with_stream(t25_pairs[i][1], &size);
+        rendered = render_with_stream(t25_pairs[i][0], &stream_length);
+        if (size != stream_length || memcmp(rendered, expected, size) != 0)
+        {
+            strb_append(error_builder, "Case 25: Fixed width did not grow:\n%.*s\nExpected:\n%.*s\n", (int)stream_length, rendered, (int)size, expected);
+            success = false;
+        }
+        free(expected);
+        free(rendered);
+    }
+    free_table(t25_grown);
+    free_table(t25_measured);
+    free_table(t25_schema);
+    free_table(t25_manual);
+
+    // Case 26: Vertically centered cells and cols are kept by snapshots
+    Table *t26 = get_empty_table();
+    const TableVAlign t26_v_aligns[2] = { V_ALIGN_TOP, V_ALIGN_CENTER };
+    set_default_alignments(t26, 2, NULL, t26_v_aligns);
+    fill_log_table(t26);
+    for (size_t i = 1; i < 300; i += 11)
+    {
+        set_position(t26, 0, i);
+        override_vertical_alignment(t26, V_ALIGN_CENTER);
+    }
+    create_temp_file(&snapshot_path);
+    Table *t26_loaded = table_save(t26, snapshot_path) ? table_load_mapped(snapshot_path) : NULL;
+    expected = render_with_stream(t26, &size);
+    rendered = t26_loaded != NULL ? render_with_stream(t26_loaded, &stream_length) : NULL;
+    if (rendered == NULL || size != stream_length || memcmp(rendered, expected, size) != 0)
+    {
+        strb_append(error_builder, "Case 26: Snapshot with centered cells was not loaded like the saved table\n");
+        success = false;
+    }
+    free(expected);
+    free(rendered);
+    if (t26_loaded != NULL) free_table(t26_loaded);
+    remove(snapshot_path);
+    free_table(t26);
+
+    return success;
 }
 
 Test get_table_test()